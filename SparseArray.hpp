@@ -2,15 +2,17 @@
 
 #include <algorithm> // for std::find
 #include <optional> // for std::optional
-#include <type_traits> // for std::is_default_constructible
+#include <type_traits> // for std::is_destructible
+#include <utility> // for std::forward
 #include <vector> // for std::vector
 
+// elements live in optionals, they do not need to be default constructible
 template<typename T>
-concept isComponent = std::is_default_constructible<T>::value;
+concept isComponent = std::is_destructible<T>::value;
 
 // You can also mirror the definition of std :: vector that takes an additional
 // allocator.
-template<typename T, typename A = std::allocator<T>>
+template<typename T, typename A = std::allocator<std::optional<T>>>
 class SparseArray {
 public:
     using value_type = std::optional<T>;
@@ -49,10 +51,15 @@ public:
         return _data[pos];
     }
 
+    // constructs the element at pos from params, in place, growing the array if needed
     template<class... Params>
-    inline auto emplace(size_type pos, Params &&...) -> reference_type
+    inline auto emplace(size_type pos, Params &&...params) -> reference_type
     {
-        _data.emplace(_data.begin() + pos, std::nullopt);
+        if (pos >= _data.size()) {
+            _data.resize(pos + 1);
+        }
+        _data[pos].emplace(std::forward<Params>(params)...);
+        return _data[pos];
     }
 
     inline void erase(size_type pos) { _data[pos].reset(); }
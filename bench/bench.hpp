@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Minimal benchmark harness: every scenario is run `warmup` times untimed, then `repetitions` times,
+// each repetition is timed as a whole and divided by the number of entities it processed.
+namespace bench {
+
+struct Result {
+    std::string name;
+    size_t entities;
+    size_t repetitions;
+    double median_ns;
+    double p99_ns;
+    double min_ns;
+    double mean_ns;
+
+    [[nodiscard]] inline auto entities_per_second() const -> double
+    {
+        return median_ns == 0 ? 0 : static_cast<double>(entities) * 1e9 / median_ns;
+    }
+};
+
+struct Options {
+    size_t warmup = 3;
+    size_t repetitions = 30;
+    std::string filter;
+};
+
+// keeps the compiler from optimizing a computed value away
+template<typename T>
+inline void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class Runner {
+private:
+    Options options;
+    std::vector<Result> results;
+
+public:
+    explicit Runner(Options options):
+        options(std::move(options))
+    {
+    }
+
+    // also true for a prefix of a selected name, so a whole family can skip its setup
+    [[nodiscard]] inline auto selected(std::string_view name) const -> bool
+    {
+        return options.filter.empty() || name.find(options.filter) != std::string_view::npos ||
+               std::string_view(options.filter).find(name) != std::string_view::npos;
+    }
+
+    // setup() builds fresh state before every repetition and is not timed, run(state) is
+    template<typename Setup, typename Run>
+    inline void run(const std::string &name, size_t entities, Setup &&setup, Run &&run)
+    {
+        if (!selected(name)) {
+            return;
+        }
+        std::vector<double> samples;
+        samples.reserve(options.repetitions);
+        for (size_t i = 0; i < options.warmup + options.repetitions; i++) {
+            auto state = setup();
+            auto start = std::chrono::steady_clock::now();
+            run(state);
+            auto end = std::chrono::steady_clock::now();
+            do_not_optimize(state);
+            if (i >= options.warmup) {
+                samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+            }
+        }
+        std::sort(samples.begin(), samples.end());
+        double sum = 0;
+        for (double sample : samples) {
+            sum += sample;
+        }
+        auto at = [&](double q) {
+            return samples[static_cast<size_t>(q * static_cast<double>(samples.size() - 1))];
+        };
+        Result result {name, entities, samples.size(), at(0.5), at(0.99), samples.front(),
+                       sum / static_cast<double>(samples.size())};
+        std::cerr << std::left << std::setw(44) << result.name << std::right << std::setw(8) << entities
+                  << " entities  median " << std::setw(12) << std::fixed << std::setprecision(0)
+                  << result.median_ns << " ns  p99 " << std::setw(12) << result.p99_ns << " ns  "
+                  << std::setw(14) << result.entities_per_second() << " entities/s\n";
+        results.push_back(std::move(result));
+    }
+
+    // same as run() without per-repetition state
+    template<typename Run>
+    inline void run(const std::string &name, size_t entities, Run &&run_fn)
+    {
+        run(name, entities, []() { return 0; }, [&](int &) { run_fn(); });
+    }
+
+    inline void write_json(std::ostream &os) const
+    {
+        os << "{\n  \"warmup\": " << options.warmup << ",\n  \"repetitions\": " << options.repetitions
+           << ",\n  \"results\": [\n";
+        os << std::fixed << std::setprecision(1);
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto &result = results[i];
+            os << "    {\"name\": \"" << result.name << "\", \"entities\": " << result.entities
+               << ", \"median_ns\": " << result.median_ns << ", \"p99_ns\": " << result.p99_ns
+               << ", \"min_ns\": " << result.min_ns << ", \"mean_ns\": " << result.mean_ns
+               << ", \"entities_per_second\": " << result.entities_per_second() << "}"
+               << (i + 1 == results.size() ? "\n" : ",\n");
+        }
+        os << "  ]\n}\n";
+    }
+};
+
+} // namespace bench
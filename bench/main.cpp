@@ -0,0 +1,640 @@
+
+#include "Hierarchy.hpp"
+#include "Scheduler.hpp"
+#include "Streaming.hpp"
+#include "WorldShard.hpp"
+#include "World.hpp"
+#include "bench.hpp"
+#include "components.hpp"
+#include "systems.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Scenario benchmarks, run with `xmake run bench [--filter name] [--json out.json] [--reps N]`
+
+// generic payload components for the view benchmarks
+template<size_t N>
+struct BData {
+    float value;
+};
+
+// marker added and removed every frame by the thrash benchmark
+struct BMarker {
+    size_t entity;
+};
+
+using BenchWorld = World<
+    BData<0>, BData<1>, BData<2>, BData<3>, BData<4>, BData<5>, BData<6>, BData<7>, CPosition, CRectangle,
+    CCollider, BMarker, CVelocity, CSpeed, CPlayer>;
+
+// entities having BData<0..7>, each with probability density
+static auto make_view_world(size_t entities, double density) -> BenchWorld
+{
+    BenchWorld world;
+    std::mt19937 rng(42);
+    std::bernoulli_distribution keep(density);
+    for (size_t i = 0; i < entities; i++) {
+        auto entity = world.new_entity();
+        if (keep(rng)) {
+            [&]<size_t... Is>(std::index_sequence<Is...>) {
+                (world.template add<BData<Is>>(entity, BData<Is> {static_cast<float>(i)}), ...);
+            }(std::make_index_sequence<8>());
+        } else {
+            world.template add<BData<0>>(entity, BData<0> {0});
+        }
+    }
+    return world;
+}
+
+template<size_t... Is>
+static void bench_view(bench::Runner &runner, BenchWorld &world, double density, std::index_sequence<Is...>)
+{
+    size_t entities = world.size();
+    auto name = "view/" + std::to_string(sizeof...(Is)) + "/density_" +
+                std::to_string(static_cast<int>(density * 100));
+    runner.run(name, entities, [&world]() {
+        float sum = 0;
+        for (auto entity : world.template view<BData<Is>...>()) {
+            if (auto opt = world.template get<BData<Is>...>(entity); opt.has_value()) {
+                std::apply([&sum](auto &...data) { sum += (data.value + ...); }, opt.value());
+            }
+        }
+        bench::do_not_optimize(sum);
+    });
+}
+
+static void bench_spawn(bench::Runner &runner, size_t entities)
+{
+    // growth from the default capacity, every increase_capacity copy included
+    runner.run(
+        "spawn/grow", entities, []() { return BenchWorld {}; },
+        [entities](BenchWorld &world) {
+            for (size_t i = 0; i < entities; i++) {
+                world.new_entity();
+            }
+        }
+    );
+}
+
+static void bench_churn(bench::Runner &runner, size_t entities)
+{
+    // delete a random half of the entities and spawn them back, ids are reused through the holes
+    runner.run(
+        "spawn/churn", entities,
+        [entities]() {
+            BenchWorld world;
+            for (size_t i = 0; i < entities; i++) {
+                world.template add<CPosition>(world.new_entity(), CPosition {0, 0});
+            }
+            return world;
+        },
+        [entities](BenchWorld &world) {
+            std::mt19937 rng(7);
+            std::vector<size_t> ids(entities);
+            std::iota(ids.begin(), ids.end(), 0);
+            std::shuffle(ids.begin(), ids.end(), rng);
+            for (size_t i = 0; i < entities / 2; i++) {
+                world.delete_entity(ids[i]);
+            }
+            for (size_t i = 0; i < entities / 2; i++) {
+                world.template add<CPosition>(world.new_entity(), CPosition {1, 1});
+            }
+        }
+    );
+}
+
+static void bench_concurrent_spawn(bench::Runner &runner, size_t entities, size_t threads)
+{
+    // entities with a CPosition and a CVelocity created by `threads` workers, thread start-up included
+    runner.run(
+        "spawn/concurrent/" + std::to_string(threads), entities, []() { return BenchWorld {}; },
+        [entities, threads](BenchWorld &world) {
+            auto scope = world.concurrent(entities);
+            {
+                std::vector<std::jthread> workers;
+                for (size_t t = 0; t < threads; t++) {
+                    workers.emplace_back([&scope]() {
+                        auto worker = scope.worker();
+                        while (auto idx = worker.new_entity()) {
+                            worker.add<CPosition>(*idx, CPosition {0, 0});
+                            worker.add<CVelocity>(*idx, CVelocity {1, 1});
+                        }
+                    });
+                }
+            }
+            scope.commit();
+        }
+    );
+}
+
+static void bench_insert(bench::Runner &runner, size_t entities)
+{
+    // CPosition and CVelocity copied from arrays to fresh entities: add, emplace and add_bulk
+    if (!runner.selected("insert/")) {
+        return;
+    }
+    auto setup = [entities]() {
+        BenchWorld world;
+        world.reserve(entities);
+        for (size_t i = 0; i < entities; i++) {
+            world.new_entity();
+        }
+        return world;
+    };
+    std::vector<Entity> ids(entities);
+    std::iota(ids.begin(), ids.end(), 0);
+    std::vector<CPosition> positions(entities);
+    for (size_t i = 0; i < entities; i++) {
+        positions[i] = CPosition {static_cast<float>(i), 0};
+    }
+    std::vector<CVelocity> velocities(entities, CVelocity {0, 1});
+
+    runner.run("insert/add", entities, setup, [&](BenchWorld &world) {
+        for (size_t i = 0; i < entities; i++) {
+            world.template add<CPosition>(ids[i], CPosition {positions[i]});
+            world.template add<CVelocity>(ids[i], CVelocity {velocities[i]});
+        }
+    });
+    runner.run("insert/emplace", entities, setup, [&](BenchWorld &world) {
+        for (size_t i = 0; i < entities; i++) {
+            world.template emplace<CPosition>(ids[i], positions[i].x, positions[i].y);
+            world.template emplace<CVelocity>(ids[i], velocities[i].x, velocities[i].y);
+        }
+    });
+    runner.run("insert/bulk", entities, setup, [&](BenchWorld &world) {
+        world.template add_bulk<CPosition>(ids, positions);
+        world.template add_bulk<CVelocity>(ids, velocities);
+    });
+}
+
+static void bench_sparse_driver(bench::Runner &runner, size_t entities)
+{
+    if (!runner.selected("view/sparse_driver")) {
+        return;
+    }
+    // view<CPlayer, CPosition, CVelocity> with a single player, the planner drives it from CPlayer
+    BenchWorld world;
+    for (size_t i = 0; i < entities; i++) {
+        auto entity = world.new_entity();
+        world.template add<CPosition>(entity, CPosition {0, 0});
+        world.template add<CVelocity>(entity, CVelocity {1, 1});
+    }
+    world.template add<CPlayer>(entities / 2, CPlayer {});
+    runner.run("view/sparse_driver", entities, [&world]() {
+        size_t found = 0;
+        for (auto entity : world.template view<CPlayer, CPosition, CVelocity>()) {
+            found += entity;
+        }
+        bench::do_not_optimize(found);
+    });
+}
+
+static void bench_thrash(bench::Runner &runner, size_t entities)
+{
+    // add then remove a marker component on every entity, the per-frame report events replace
+    if (!runner.selected("add_remove/thrash")) {
+        return;
+    }
+    BenchWorld world;
+    for (size_t i = 0; i < entities; i++) {
+        world.template add<CPosition>(world.new_entity(), CPosition {0, 0});
+    }
+    runner.run("add_remove/thrash", entities, [&world]() {
+        for (auto entity : world.template view<CPosition>()) {
+            world.template add<BMarker>(entity, BMarker {entity});
+        }
+        for (auto entity : world.template view<CPosition>()) {
+            world.template remove<BMarker>(entity);
+        }
+    });
+}
+
+static void bench_events(bench::Runner &runner, size_t entities)
+{
+    // the same report as add_remove/thrash through an event channel: emit for every entity, then clear
+    if (!runner.selected("events/emit")) {
+        return;
+    }
+    BenchWorld world;
+    for (size_t i = 0; i < entities; i++) {
+        world.template add<CPosition>(world.new_entity(), CPosition {0, 0});
+    }
+    runner.run("events/emit", entities, [&world]() {
+        for (auto entity : world.template view<CPosition>()) {
+            world.emit(BMarker {entity});
+        }
+        world.clear_events();
+    });
+}
+
+static void bench_cache(bench::Runner &runner, size_t entities)
+{
+    // a list of the entities having CRectangle kept up to date while 1% of them lose or gain it every tick,
+    // rebuilt from a view or maintained by observers
+    if (!runner.selected("cache/")) {
+        return;
+    }
+    BenchWorld world;
+    for (size_t i = 0; i < entities; i++) {
+        auto entity = world.new_entity();
+        world.template add<CPosition>(entity, CPosition {0, 0});
+        if (i % 2 == 0) {
+            world.template add<CRectangle>(entity, CRectangle {1, 1});
+        }
+    }
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<size_t> pick(0, entities - 1);
+    auto churn = [&world, &rng, &pick, entities]() {
+        for (size_t i = 0; i < entities / 100; i++) {
+            size_t entity = pick(rng);
+            if (world.template get<CRectangle>(entity)) {
+                world.template remove<CRectangle>(entity);
+            } else {
+                world.template add<CRectangle>(entity, CRectangle {1, 1});
+            }
+        }
+    };
+
+    std::vector<size_t> list;
+    runner.run("cache/rebuild", entities, [&world, &list, &churn]() {
+        churn();
+        list.clear();
+        for (auto entity : world.template view<CRectangle>()) {
+            list.push_back(entity);
+        }
+        bench::do_not_optimize(list.data());
+    });
+
+    // position of every entity in the list, swap and pop on removal
+    constexpr size_t absent = static_cast<size_t>(-1);
+    list.clear();
+    std::vector<size_t> position(entities, absent);
+    for (auto entity : world.template view<CRectangle>()) {
+        position[entity] = list.size();
+        list.push_back(entity);
+    }
+    auto added = world.template on_add<CRectangle>([&list, &position](std::span<const Entity> added) {
+        for (auto entity : added) {
+            position[entity] = list.size();
+            list.push_back(entity);
+        }
+    });
+    auto removed = world.template on_remove<CRectangle>([&list, &position](std::span<const Entity> removed) {
+        for (auto entity : removed) {
+            size_t at = position[entity];
+            position[list.back()] = at;
+            list[at] = list.back();
+            list.pop_back();
+            position[entity] = absent;
+        }
+    });
+    runner.run("cache/incremental", entities, [&list, &churn]() {
+        churn();
+        bench::do_not_optimize(list.data());
+    });
+    world.unobserve(added);
+    world.unobserve(removed);
+}
+
+static void bench_hierarchy(bench::Runner &runner, size_t roots)
+{
+    // roots with 3 children having 2 children each, created in a shuffled order so that links jump across
+    // the tables: every attached position recomputed, by depth or by walking up to the root
+    if (!runner.selected("hierarchy/")) {
+        return;
+    }
+    World<CPosition, CAttachment> world;
+    Hierarchy hierarchy;
+    size_t entities = roots * 10;
+    std::vector<size_t> ids(entities);
+    std::iota(ids.begin(), ids.end(), 0);
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(1234));
+    for (size_t i = 0; i < entities; i++) {
+        world.template add<CPosition>(world.new_entity(), CPosition {static_cast<float>(i), 0});
+    }
+    for (size_t root = 0; root < roots; root++) {
+        const size_t *family = &ids[root * 10];
+        for (size_t child = 1; child < 10; child++) {
+            world.template add<CAttachment>(family[child], CAttachment {1, 1});
+            hierarchy.set_parent(family[child], family[child < 4 ? 0 : (child - 4) / 2 + 1]);
+        }
+    }
+
+    runner.run("hierarchy/propagate", entities, [&world, &hierarchy]() {
+        Sattachment_update(world, hierarchy);
+    });
+    runner.run("hierarchy/lookup", entities, [&world, &hierarchy]() {
+        for (auto entity : world.template view<CAttachment>()) {
+            CPosition offset {0, 0};
+            size_t top = entity;
+            for (auto parent = hierarchy.parent(top); parent.has_value(); parent = hierarchy.parent(top)) {
+                auto [attachment] = world.template get<CAttachment>(top).value();
+                offset.x += attachment.x;
+                offset.y += attachment.y;
+                top = parent.value();
+            }
+            auto [root] = world.template get<CPosition>(top).value();
+            auto [pos] = world.template get<CPosition>(entity).value();
+            pos = CPosition {root.x + offset.x, root.y + offset.y};
+        }
+    });
+}
+
+static void bench_store_previous(bench::Runner &runner, size_t entities)
+{
+    // tick boundary of the buffered CPosition: the current positions copied over the previous ones
+    if (!runner.selected("buffered/store_previous")) {
+        return;
+    }
+    BenchWorld world;
+    for (size_t i = 0; i < entities; i++) {
+        world.template add<CPosition>(world.new_entity(), CPosition {static_cast<float>(i), 0});
+    }
+    runner.run("buffered/store_previous", entities, [&world]() { world.store_previous(); });
+}
+
+static void bench_streaming(bench::Runner &runner, size_t entities)
+{
+    // moving boxes spread over a map 40 cells wide, the player sees the 5x5 cells around it: a tick over
+    // the whole map, the same tick over the cells kept by the streamer, and the player crossing a cell
+    // (a column of cells stored, the one ahead loaded back)
+    if (!runner.selected("stream/")) {
+        return;
+    }
+    using Streamer = CellStreamer<CPosition, CVelocity, CSpeed>;
+    constexpr float cell = 500;
+    constexpr float side = cell * 40;
+    auto populate = [entities](BenchWorld &world) {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> coord(0, side);
+        for (size_t i = 0; i < entities; i++) {
+            auto entity = world.new_entity();
+            world.template add<CPosition>(entity, CPosition {coord(rng), coord(rng)});
+            world.template add<CVelocity>(entity, CVelocity {0, 0});
+            world.template add<CSpeed>(entity, CSpeed {100});
+        }
+    };
+    auto tick = [](BenchWorld &world) {
+        Sgravity_update(world, 1.0f / 60.0f);
+        Smovement_update(world, 1.0f / 60.0f);
+    };
+    const CPosition center[] = {{side / 2, side / 2}};
+    const CPosition next[] = {{side / 2 + cell, side / 2}};
+
+    BenchWorld full;
+    populate(full);
+    runner.run("stream/tick_full", entities, [&full, &tick]() { tick(full); });
+
+    BenchWorld resident;
+    populate(resident);
+    Streamer streamer(cell, 2);
+    streamer.update(resident, center);
+    runner.run("stream/tick_resident", entities, [&resident, &tick]() { tick(resident); });
+
+    runner.run("stream/cross_cell", entities, [&resident, &streamer, &center, &next]() {
+        streamer.update(resident, next);
+        streamer.flush(resident);
+        streamer.update(resident, center);
+        streamer.flush(resident);
+    });
+}
+
+static void bench_shards(bench::Runner &runner, size_t entities)
+{
+    // the same boxes split over 1, 2, 4 and one shard per hardware thread, each shard stepped by its own
+    // thread: gravity and movement over every shard, time per tick should fall with the thread count
+    if (!runner.selected("shard/")) {
+        return;
+    }
+    size_t hardware = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    std::vector<size_t> counts {1, 2, 4};
+    if (std::find(counts.begin(), counts.end(), hardware) == counts.end()) {
+        counts.push_back(hardware);
+    }
+    for (size_t count : counts) {
+        WorldShard<CPosition, CVelocity, CSpeed, CPlayer> sharded(count, count);
+        for (size_t i = 0; i < entities; i++) {
+            auto ref = sharded.new_entity(i % count);
+            auto &world = sharded.shard(ref.shard);
+            world.template add<CPosition>(ref.entity, CPosition {static_cast<float>(i), 0});
+            world.template add<CVelocity>(ref.entity, CVelocity {0, 0});
+            world.template add<CSpeed>(ref.entity, CSpeed {100});
+        }
+        runner.run("shard/" + std::to_string(count), entities, [&sharded]() {
+            sharded.step([](auto &world, size_t) {
+                Sgravity_update(world, 1.0f / 60.0f);
+                Smovement_update(world, 1.0f / 60.0f);
+            });
+        });
+    }
+}
+
+static void bench_collision(bench::Runner &runner, size_t entities)
+{
+    // boxes scattered over a square sized so that roughly a third of them overlap another one
+    auto setup = [entities]() {
+        BenchWorld world;
+        std::mt19937 rng(1234);
+        float side = 20.0f * std::sqrt(static_cast<float>(entities)) * 2.0f;
+        std::uniform_real_distribution<float> coord(0, side);
+        for (size_t i = 0; i < entities; i++) {
+            auto entity = world.new_entity();
+            world.template add<CPosition>(entity, CPosition {coord(rng), coord(rng)});
+            world.template add<CRectangle>(entity, CRectangle {20, 20});
+            world.template add<CCollider>(entity, CCollider {});
+            world.template add<CSpeed>(entity, CSpeed {100});
+            world.template add<CVelocity>(entity, CVelocity {0, 1});
+        }
+        return world;
+    };
+    runner.run("collision/" + std::to_string(entities), entities, setup, [](BenchWorld &world) {
+        world.clear_events();
+        Scollision_update(world, 1.0f / 60.0f);
+    });
+}
+
+static void bench_gather(bench::Runner &runner, size_t entities)
+{
+    // swept AABB against entities reached through a shuffled id list, as when following the ids stored
+    // in events or components, over tables larger than the caches
+    if (!runner.selected("gather/")) {
+        return;
+    }
+    BenchWorld world;
+    world.reserve(entities);
+    for (size_t i = 0; i < entities; i++) {
+        auto entity = world.new_entity();
+        world.template add<CPosition>(entity, CPosition {static_cast<float>(i % 1000), 0});
+        world.template add<CRectangle>(entity, CRectangle {10, 10});
+        world.template add<CCollider>(entity, CCollider {});
+    }
+    std::vector<Entity> ids(entities);
+    std::iota(ids.begin(), ids.end(), 0);
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(1234));
+
+    CPosition origin {500, 5};
+    CRectangle box {10, 10};
+    CVelocity velocity {1, 0};
+    auto sweep = [&](CPosition &pos, CRectangle &rect) {
+        CVelocity still {0, 0};
+        float normalx;
+        float normaly;
+        return swept_aabb(origin, box, velocity, pos, rect, still, normalx, normaly);
+    };
+    runner.run("gather/get", entities, [&world, &ids, &sweep]() {
+        float sum = 0;
+        for (auto entity : ids) {
+            if (auto opt = world.template get<CPosition, CRectangle, CCollider>(entity); opt.has_value()) {
+                auto &[pos, rect, _] = opt.value();
+                sum += sweep(pos, rect);
+            }
+        }
+        bench::do_not_optimize(sum);
+    });
+    std::vector<std::tuple<CPosition *, CRectangle *, CCollider *>> rows(entities);
+    runner.run("gather/get_many", entities, [&world, &ids, &sweep, &rows]() {
+        world.template get_many<CPosition, CRectangle, CCollider>(
+            ids, std::span<std::tuple<CPosition *, CRectangle *, CCollider *>>(rows)
+        );
+        float sum = 0;
+        for (const auto &[pos, rect, _] : rows) {
+            if (pos != nullptr) {
+                sum += sweep(*pos, *rect);
+            }
+        }
+        bench::do_not_optimize(sum);
+    });
+    for (size_t distance : {0, 4, 8, 16, 32}) {
+        auto name = "gather/each_many/" + std::to_string(distance);
+        runner.run(name, entities, [&world, &ids, &sweep, distance]() {
+            float sum = 0;
+            world.template each_many<CPosition, CRectangle, CCollider>(
+                ids, [&](size_t, CPosition &pos, CRectangle &rect, CCollider &) { sum += sweep(pos, rect); },
+                distance
+            );
+            bench::do_not_optimize(sum);
+        });
+    }
+}
+
+static auto bench_timer(Scheduler &scheduler, float period, size_t &fired) -> Task
+{
+    for (;;) {
+        co_await scheduler.wait(period);
+        fired++;
+    }
+}
+
+static void bench_scheduler(bench::Runner &runner, size_t tasks)
+{
+    // one tick of a clock with tasks timers asleep for 1 to 60 seconds, a few of them fire on any tick
+    if (!runner.selected("scheduler/dormant")) {
+        return;
+    }
+    Scheduler scheduler(1.0f / 60.0f);
+    size_t fired = 0;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> period(1.0f, 60.0f);
+    for (size_t i = 0; i < tasks; i++) {
+        scheduler.spawn(bench_timer(scheduler, period(rng), fired));
+    }
+    runner.run("scheduler/dormant", tasks, [&scheduler, &fired]() {
+        scheduler.advance();
+        bench::do_not_optimize(fired);
+    });
+}
+
+#ifdef BECS_PROFILE
+// an empty zone against the timestamp it reads twice, drained before every run (zones < ring capacity)
+static void bench_profiler(bench::Runner &runner, size_t zones)
+{
+    runner.run(
+        "profiler/empty_zone", zones,
+        []() {
+            profiler::end_frame();
+            return 0;
+        },
+        [zones](int &) {
+            for (size_t i = 0; i < zones; i++) {
+                PROFILE_ZONE("bench/empty_zone");
+            }
+        }
+    );
+    runner.run("profiler/timestamp", zones, [zones]() {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < zones; i++) {
+            sum += profiler::now();
+        }
+        bench::do_not_optimize(sum);
+    });
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    bench::Options options;
+    std::string json_path;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--reps" && i + 1 < argc) {
+            options.repetitions = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--filter name] [--json out.json] [--reps N]\n";
+            return 1;
+        }
+    }
+
+    bench::Runner runner(options);
+
+    for (size_t entities : {1000, 10000}) {
+        bench_spawn(runner, entities);
+        bench_churn(runner, entities);
+    }
+    for (size_t threads : {1, 4}) {
+        bench_concurrent_spawn(runner, 1000000, threads);
+    }
+    for (double density : {0.1, 0.5, 1.0}) {
+        if (!runner.selected("view/")) {
+            break;
+        }
+        auto world = make_view_world(100000, density);
+        bench_view(runner, world, density, std::make_index_sequence<1>());
+        bench_view(runner, world, density, std::make_index_sequence<2>());
+        bench_view(runner, world, density, std::make_index_sequence<4>());
+        bench_view(runner, world, density, std::make_index_sequence<8>());
+    }
+    bench_insert(runner, 100000);
+    bench_sparse_driver(runner, 100000);
+    bench_thrash(runner, 100000);
+    bench_events(runner, 100000);
+    bench_cache(runner, 100000);
+    bench_store_previous(runner, 100000);
+    for (size_t entities : {256, 1024}) {
+        bench_collision(runner, entities);
+    }
+    bench_gather(runner, 1000000);
+    bench_scheduler(runner, 100000);
+    bench_hierarchy(runner, 10000);
+    bench_streaming(runner, 200000);
+    bench_shards(runner, 400000);
+#ifdef BECS_PROFILE
+    bench_profiler(runner, 50000);
+#endif
+
+    if (!json_path.empty()) {
+        std::ofstream out(json_path);
+        runner.write_json(out);
+    }
+    return 0;
+}
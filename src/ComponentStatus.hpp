@@ -180,6 +180,10 @@ public:
     {
     }
 
+    // bitfield having the bit of each of Ts set, used to match a whole signature at once
+    template<typename... Ts>
+    static constexpr storage_type mask = static_cast<storage_type>((0 | ... | BitPosition<Ts, Structures...>::value));
+
     template<typename T>
     inline void activate()
     {
@@ -198,6 +202,17 @@ public:
         return (bitfield & BitPosition<T, Structures...>::value) != 0;
     }
 
+    [[nodiscard]] inline bool contains(storage_type signature) const
+    {
+        return (bitfield & signature) == signature;
+    }
+
+    // no bit set outside signature
+    [[nodiscard]] inline bool containsOnly(storage_type signature) const
+    {
+        return (bitfield & ~signature) == 0;
+    }
+
     template<typename T>
     [[nodiscard]] inline size_t position() const
     {
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// Per-component settings read by the world and its storage.
+// Specialize component_traits<C> next to the component, declaring only the settings that change, e.g.
+//   template<>
+//   struct component_traits<CPosition> {
+//       static constexpr Placement placement = Placement::Hot;
+//       static constexpr bool buffered = true;
+//   };
+
+// where the storage puts the table of a component, picked from the access counts of a profiled run
+// (the reads and writes per tick printed by World::stats())
+enum class Placement : uint8_t {
+    // whatever the storage does for every table
+    Default,
+    // touched by most systems every tick: cache line aligned and backed by huge pages when large enough
+    Hot,
+    // rarely touched: kept out of the huge pages so they go to the hot tables
+    Cold,
+};
+
+template<typename C>
+struct component_traits {
+};
+
+// buffered components keep a copy of their values at the end of the previous tick next to the current
+// ones, see World::previous and World::store_previous
+template<typename C>
+constexpr bool buffered_v = []() {
+    if constexpr (requires { component_traits<C>::buffered; }) {
+        return component_traits<C>::buffered;
+    } else {
+        return false;
+    }
+}();
+
+template<typename C>
+constexpr Placement placement_v = []() {
+    if constexpr (requires { component_traits<C>::placement; }) {
+        return component_traits<C>::placement;
+    } else {
+        return Placement::Default;
+    }
+}();
@@ -0,0 +1,172 @@
+#pragma once
+
+// Typed event channels
+// Systems report what happened during a tick (e.g. a collision) by emitting an event instead of adding
+// and removing a marker component: an emit is an append to a packed array, with no structural change to
+// the world, and the consumers read the array as is. The events of a tick are cleared at the next frame
+// boundary (BasicWorld::clear_events).
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+class EventChannelBase {
+public:
+    virtual ~EventChannelBase() = default;
+    virtual void clear() = 0;
+    [[nodiscard]] virtual auto clone() const -> std::unique_ptr<EventChannelBase> = 0;
+    [[nodiscard]] virtual auto capacity_bytes() const -> size_t = 0;
+};
+
+// the events of type E emitted since the last clear, in emission order (merge order for writers)
+template<typename E>
+class EventChannel final : public EventChannelBase {
+private:
+    std::vector<E> events;
+    // taken by the writers of the other threads when they merge their buffer
+    std::mutex mutex;
+
+public:
+    EventChannel() = default;
+
+    // one per thread, buffers its events and merges them in the channel on flush() or destruction
+    class Writer {
+    private:
+        EventChannel &channel;
+        std::vector<E> buffer;
+
+    public:
+        explicit Writer(EventChannel &channel):
+            channel(channel)
+        {
+        }
+
+        Writer(const Writer &) = delete;
+        auto operator=(const Writer &) -> Writer & = delete;
+
+        ~Writer()
+        {
+            flush();
+        }
+
+        inline void emit(E event) { buffer.push_back(std::move(event)); }
+
+        inline void flush()
+        {
+            if (buffer.empty()) {
+                return;
+            }
+            std::lock_guard lock(channel.mutex);
+            channel.events.insert(
+                channel.events.end(), std::make_move_iterator(buffer.begin()),
+                std::make_move_iterator(buffer.end())
+            );
+            buffer.clear();
+        }
+    };
+
+    // single writer, not to be mixed with Writers flushing from other threads
+    inline void emit(E event) { events.push_back(std::move(event)); }
+
+    [[nodiscard]] inline auto read() const -> std::span<const E> { return events; }
+
+    // keeps the capacity, a tick emits about as many events as the previous one
+    inline void clear() override { events.clear(); }
+
+    [[nodiscard]] auto clone() const -> std::unique_ptr<EventChannelBase> override
+    {
+        auto copy = std::make_unique<EventChannel>();
+        copy->events = events;
+        return copy;
+    }
+
+    [[nodiscard]] auto capacity_bytes() const -> size_t override { return events.capacity() * sizeof(E); }
+};
+
+// One channel per event type, created on first use. Creating a channel is not thread safe: the first
+// emit, writer or events call for a type has to happen on one thread, e.g. before the workers start.
+class EventRegistry {
+private:
+    std::vector<std::unique_ptr<EventChannelBase>> channels;
+
+    static inline std::atomic<size_t> next_type_id = 0;
+
+    // process wide index of E, the same in every world
+    template<typename E>
+    static auto type_id() -> size_t
+    {
+        static const size_t id = next_type_id.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+
+public:
+    EventRegistry() = default;
+
+    EventRegistry(const EventRegistry &other)
+    {
+        *this = other;
+    }
+
+    auto operator=(const EventRegistry &other) -> EventRegistry &
+    {
+        if (this == &other) {
+            return *this;
+        }
+        channels.clear();
+        channels.reserve(other.channels.size());
+        for (const auto &channel : other.channels) {
+            channels.push_back(channel ? channel->clone() : nullptr);
+        }
+        return *this;
+    }
+
+    EventRegistry(EventRegistry &&) noexcept = default;
+    auto operator=(EventRegistry &&) noexcept -> EventRegistry & = default;
+    ~EventRegistry() = default;
+
+    template<typename E>
+    [[nodiscard]] inline auto channel() -> EventChannel<E> &
+    {
+        size_t id = type_id<E>();
+        if (id >= channels.size()) {
+            channels.resize(id + 1);
+        }
+        if (!channels[id]) {
+            channels[id] = std::make_unique<EventChannel<E>>();
+        }
+        return static_cast<EventChannel<E> &>(*channels[id]);
+    }
+
+    // nullptr when nothing was ever emitted as E
+    template<typename E>
+    [[nodiscard]] inline auto find() const -> const EventChannel<E> *
+    {
+        size_t id = type_id<E>();
+        if (id >= channels.size() || !channels[id]) {
+            return nullptr;
+        }
+        return static_cast<const EventChannel<E> *>(channels[id].get());
+    }
+
+    inline void clear()
+    {
+        for (auto &channel : channels) {
+            if (channel) {
+                channel->clear();
+            }
+        }
+    }
+
+    [[nodiscard]] inline auto capacity_bytes() const -> size_t
+    {
+        size_t bytes = 0;
+        for (const auto &channel : channels) {
+            bytes += channel ? channel->capacity_bytes() : 0;
+        }
+        return bytes;
+    }
+};
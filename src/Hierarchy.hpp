@@ -0,0 +1,268 @@
+#pragma once
+
+// Parent/child links between entities, e.g. a weapon carried by the player
+// Every entity has at most one parent, links are kept by entity id in intrusive lists: linking,
+// unlinking and reparenting are O(1) and only mark the hierarchy dirty. The first traversal after a
+// change rebuilds packed arrays of the links sorted by depth (breadth first from the roots), so a
+// propagation pass walks them linearly and always finds the parent updated before its children.
+// The links of one depth never depend on each other, a level can be split across threads.
+// Ids are the world's: patch them with remap() after a sort_by (the packed links are patched in place,
+// nothing is rebuilt), and remove() deleted entities (track() does it with an on_delete observer).
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+class Hierarchy {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    struct Link {
+        size_t parent;
+        size_t child;
+    };
+
+private:
+    // by entity id, npos where there is no such neighbour
+    struct Node {
+        size_t parent = npos;
+        size_t first_child = npos;
+        size_t next_sibling = npos;
+        size_t prev_sibling = npos;
+        // index of the link to its parent in packed, valid while not dirty
+        size_t link = npos;
+    };
+
+    std::vector<Node> nodes;
+    size_t links = 0;
+    bool dirty = false;
+    // links by depth, level d is packed[level_begin[d], level_begin[d + 1])
+    std::vector<Link> packed;
+    std::vector<size_t> level_begin {0};
+
+    inline auto node(size_t entity) -> Node &
+    {
+        if (entity >= nodes.size()) {
+            nodes.resize(entity + 1);
+        }
+        return nodes[entity];
+    }
+
+    inline void unlink(size_t child)
+    {
+        Node &linked = nodes[child];
+        if (linked.prev_sibling != npos) {
+            nodes[linked.prev_sibling].next_sibling = linked.next_sibling;
+        } else {
+            nodes[linked.parent].first_child = linked.next_sibling;
+        }
+        if (linked.next_sibling != npos) {
+            nodes[linked.next_sibling].prev_sibling = linked.prev_sibling;
+        }
+        linked.parent = npos;
+        linked.next_sibling = npos;
+        linked.prev_sibling = npos;
+        links--;
+        dirty = true;
+    }
+
+    inline void push_children(size_t parent)
+    {
+        for (size_t child = nodes[parent].first_child; child != npos; child = nodes[child].next_sibling) {
+            nodes[child].link = packed.size();
+            packed.push_back({parent, child});
+        }
+    }
+
+    inline void rebuild()
+    {
+        packed.clear();
+        level_begin.assign(1, 0);
+        for (size_t entity = 0; entity < nodes.size(); entity++) {
+            if (nodes[entity].parent == npos) {
+                push_children(entity);
+            }
+        }
+        while (level_begin.back() < packed.size()) {
+            size_t begin = level_begin.back();
+            size_t end = packed.size();
+            level_begin.push_back(end);
+            for (size_t i = begin; i < end; i++) {
+                push_children(packed[i].child);
+            }
+        }
+        // the links left out are not reachable from a root
+        if (packed.size() != links) {
+            std::cerr << "Hierarchy: " << links - packed.size() << " links are part of a cycle\n";
+            std::abort();
+        }
+        dirty = false;
+    }
+
+public:
+    Hierarchy() = default;
+
+    // replaces the parent child had, if any
+    inline void set_parent(size_t child, size_t parent)
+    {
+        if (child == parent) {
+            std::cerr << "Hierarchy: entity " << child << " cannot be its own parent\n";
+            std::abort();
+        }
+        node(std::max(child, parent));
+        if (nodes[child].parent == parent) {
+            return;
+        }
+        if (nodes[child].parent != npos) {
+            unlink(child);
+        }
+        Node &linked = nodes[child];
+        linked.parent = parent;
+        linked.next_sibling = nodes[parent].first_child;
+        if (linked.next_sibling != npos) {
+            nodes[linked.next_sibling].prev_sibling = child;
+        }
+        nodes[parent].first_child = child;
+        links++;
+        dirty = true;
+    }
+
+    // child becomes a root, its own children stay attached to it
+    inline void detach(size_t child)
+    {
+        if (child < nodes.size() && nodes[child].parent != npos) {
+            unlink(child);
+        }
+    }
+
+    // forgets every link of entity, its children become roots
+    inline void remove(size_t entity)
+    {
+        if (entity >= nodes.size()) {
+            return;
+        }
+        detach(entity);
+        while (nodes[entity].first_child != npos) {
+            unlink(nodes[entity].first_child);
+        }
+    }
+
+    [[nodiscard]] inline auto parent(size_t child) const -> std::optional<size_t>
+    {
+        if (child >= nodes.size() || nodes[child].parent == npos) {
+            return std::nullopt;
+        }
+        return nodes[child].parent;
+    }
+
+    // patches the ids moved by World::sort_by, e.g. hierarchy.remap(world.sort_by<C>(key));
+    // only the moved entities, their neighbours and their links are touched, the links keep their order
+    template<typename Remaps>
+    inline void remap(const Remaps &remaps)
+    {
+        if (remaps.empty() || links == 0) {
+            return;
+        }
+        std::vector<std::pair<size_t, size_t>> moves;
+        moves.reserve(remaps.size());
+        size_t top = 0;
+        for (const auto &remap : remaps) {
+            moves.emplace_back(remap.from, remap.to);
+            top = std::max({top, remap.from, remap.to});
+        }
+        node(top);
+        std::sort(moves.begin(), moves.end());
+        auto translate = [&moves](size_t id) {
+            auto found = std::lower_bound(moves.begin(), moves.end(), std::pair {id, size_t {0}});
+            return found != moves.end() && found->first == id ? found->second : id;
+        };
+
+        // the moved nodes are rewritten with translated ids, then their neighbours are pointed at them
+        // (a neighbour that did not move still holds the old id, one that moved was translated already)
+        std::vector<Node> sources;
+        sources.reserve(moves.size());
+        for (const auto &[from, _] : moves) {
+            sources.push_back(std::exchange(nodes[from], Node {}));
+        }
+        for (size_t i = 0; i < moves.size(); i++) {
+            const Node &source = sources[i];
+            nodes[moves[i].second] = Node {
+                translate(source.parent), translate(source.first_child), translate(source.next_sibling),
+                translate(source.prev_sibling), source.link
+            };
+        }
+        for (const auto &[_, to] : moves) {
+            const Node moved = nodes[to];
+            if (moved.prev_sibling != npos) {
+                nodes[moved.prev_sibling].next_sibling = to;
+            } else if (moved.parent != npos) {
+                nodes[moved.parent].first_child = to;
+            }
+            if (moved.next_sibling != npos) {
+                nodes[moved.next_sibling].prev_sibling = to;
+            }
+        }
+        // the sibling lists are consistent again, the children can be walked
+        for (const auto &[_, to] : moves) {
+            if (!dirty && nodes[to].parent != npos) {
+                packed[nodes[to].link].child = to;
+            }
+            for (size_t child = nodes[to].first_child; child != npos; child = nodes[child].next_sibling) {
+                nodes[child].parent = to;
+                if (!dirty) {
+                    packed[nodes[child].link].parent = to;
+                }
+            }
+        }
+    }
+
+    // removes the links of the entities deleted from world, returns the observer for world.unobserve()
+    // the observer points at this hierarchy, which must stay in place until it is unobserved
+    template<typename World>
+    inline auto track(World &world) -> typename World::ObserverId
+    {
+        return world.on_delete([this](std::span<const size_t> entities) {
+            for (size_t entity : entities) {
+                remove(entity);
+            }
+        });
+    }
+
+    // fn(parent, child) for every link, parents before their children
+    template<typename F>
+    inline void each(F &&fn)
+    {
+        if (dirty) {
+            rebuild();
+        }
+        for (const auto &link : packed) {
+            fn(link.parent, link.child);
+        }
+    }
+
+    // fn(links) once per depth, from the children of the roots down
+    // the links of a level can be processed in any order, on as many threads as wanted
+    template<typename F>
+    inline void each_level(F &&fn)
+    {
+        if (dirty) {
+            rebuild();
+        }
+        for (size_t level = 0; level + 1 < level_begin.size(); level++) {
+            fn(std::span<const Link>(packed).subspan(
+                level_begin[level], level_begin[level + 1] - level_begin[level]
+            ));
+        }
+    }
+
+    // number of parent/child links
+    [[nodiscard]] inline auto size() const -> size_t { return links; }
+
+    // the links changed since the last traversal, the next one rebuilds the packed arrays
+    [[nodiscard]] inline auto needs_rebuild() const -> bool { return dirty; }
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+// File-backed storage for worlds larger than the RAM or that have to be reopened instantly.
+// Every table is a file mapped with mmap, the OS pages cold entities in and out and growing a table
+// extends the file (ftruncate) and the mapping (mremap) instead of copying it.
+// Only trivially copyable components can be stored: the bytes in the file are the components.
+// e.g. MappedWorld<CPosition, CVelocity> world(MappedStorage {"save"}); ... world.flush();
+// POSIX only
+
+#include "World.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+// Contiguous table of T mapped from a file, with the part of the std::vector interface the world uses.
+// Without a file (it could not be opened) the table is backed by anonymous memory and is not saved.
+template<typename T>
+class MappedTable {
+    static_assert(std::is_trivially_copyable_v<T>, "only trivially copyable components can be mapped");
+
+private:
+    int fd = -1;
+    Placement placement = Placement::Default;
+    T *data_ = nullptr;
+    size_t count = 0;
+    // bytes of the mapping, whole pages
+    size_t mapped = 0;
+
+    [[noreturn]] static void fail(const char *what)
+    {
+        std::cerr << "MappedTable: " << what << ": " << std::strerror(errno) << "\n";
+        std::abort();
+    }
+
+    static auto page_round(size_t bytes) -> size_t
+    {
+        static const auto page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        return (bytes + page - 1) / page * page;
+    }
+
+    inline void remap(size_t bytes)
+    {
+        if (bytes == mapped) {
+            return;
+        }
+        if (bytes == 0) {
+            ::munmap(data_, mapped);
+            data_ = nullptr;
+            mapped = 0;
+            return;
+        }
+        void *address = MAP_FAILED;
+        if (data_ == nullptr) {
+            int flags = fd >= 0 ? MAP_SHARED : MAP_PRIVATE | MAP_ANONYMOUS;
+            address = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, fd, 0);
+        } else {
+#ifdef __linux__
+            address = ::mremap(data_, mapped, bytes, MREMAP_MAYMOVE);
+#else
+            int flags = fd >= 0 ? MAP_SHARED : MAP_PRIVATE | MAP_ANONYMOUS;
+            address = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, fd, 0);
+            if (address != MAP_FAILED) {
+                // the file already holds the data of a shared mapping
+                if (fd < 0) {
+                    std::memcpy(address, data_, std::min(bytes, mapped));
+                }
+                ::munmap(data_, mapped);
+            }
+#endif
+        }
+        if (address == MAP_FAILED) {
+            fail("mmap");
+        }
+        data_ = static_cast<T *>(address);
+        mapped = bytes;
+        advise();
+    }
+
+    // hot tables are read ahead, cold ones are the first pages the kernel reclaims
+    inline void advise()
+    {
+#ifdef __linux__
+        if (placement == Placement::Hot) {
+            ::madvise(data_, mapped, MADV_WILLNEED);
+        }
+#ifdef MADV_COLD
+        if (placement == Placement::Cold) {
+            ::madvise(data_, mapped, MADV_COLD);
+        }
+#endif
+#endif
+    }
+
+public:
+    MappedTable() = default;
+
+    explicit MappedTable(const std::string &path, Placement placement = Placement::Default):
+        fd(::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)),
+        placement(placement)
+    {
+        if (fd < 0) {
+            std::cerr << "MappedTable: could not open " << path << " (" << std::strerror(errno)
+                      << "), the table will not be saved\n";
+            return;
+        }
+        struct stat info {};
+        if (::fstat(fd, &info) != 0) {
+            fail("fstat");
+        }
+        count = static_cast<size_t>(info.st_size) / sizeof(T);
+        remap(page_round(count * sizeof(T)));
+    }
+
+    MappedTable(const MappedTable &) = delete;
+    auto operator=(const MappedTable &) -> MappedTable & = delete;
+
+    MappedTable(MappedTable &&other) noexcept:
+        fd(std::exchange(other.fd, -1)),
+        placement(other.placement),
+        data_(std::exchange(other.data_, nullptr)),
+        count(std::exchange(other.count, 0)),
+        mapped(std::exchange(other.mapped, 0))
+    {
+    }
+
+    auto operator=(MappedTable &&other) noexcept -> MappedTable &
+    {
+        std::swap(fd, other.fd);
+        std::swap(placement, other.placement);
+        std::swap(data_, other.data_);
+        std::swap(count, other.count);
+        std::swap(mapped, other.mapped);
+        return *this;
+    }
+
+    ~MappedTable()
+    {
+        if (data_ != nullptr) {
+            ::munmap(data_, mapped);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    // new elements are zeroed (value initialized for the components this is meant for)
+    inline void resize(size_t new_count)
+    {
+        if (new_count == count) {
+            return;
+        }
+        size_t bytes = new_count * sizeof(T);
+        if (fd >= 0 && ::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            fail("ftruncate");
+        }
+        remap(page_round(bytes));
+        // a file grown by ftruncate reads as zeroes, anonymous pages kept from a shrink may not
+        if (fd < 0 && new_count > count) {
+            std::memset(static_cast<void *>(data_ + count), 0, (new_count - count) * sizeof(T));
+        }
+        count = new_count;
+    }
+
+    // blocks until the table is written to the file
+    inline void flush()
+    {
+        if (fd >= 0 && data_ != nullptr && ::msync(data_, mapped, MS_SYNC) != 0) {
+            fail("msync");
+        }
+    }
+
+    [[nodiscard]] inline auto persistent() const -> bool { return fd >= 0; }
+
+    [[nodiscard]] inline auto operator[](size_t idx) -> T & { return data_[idx]; }
+    [[nodiscard]] inline auto operator[](size_t idx) const -> const T & { return data_[idx]; }
+    [[nodiscard]] inline auto data() -> T * { return data_; }
+    [[nodiscard]] inline auto size() const -> size_t { return count; }
+    [[nodiscard]] inline auto empty() const -> bool { return count == 0; }
+    [[nodiscard]] inline auto capacity() const -> size_t { return count; }
+    [[nodiscard]] inline auto begin() -> T * { return data_; }
+    [[nodiscard]] inline auto end() -> T * { return data_ + count; }
+    [[nodiscard]] inline auto begin() const -> const T * { return data_; }
+    [[nodiscard]] inline auto end() const -> const T * { return data_ + count; }
+};
+
+// one file per table in directory: status.table, world.table and <component type>.table
+class MappedStorage {
+private:
+    std::string directory;
+
+public:
+    template<typename T>
+    using table_t = MappedTable<T>;
+
+    static constexpr bool copies_on_growth = false;
+    static constexpr bool persistent = true;
+
+    explicit MappedStorage(std::string directory):
+        directory(std::move(directory))
+    {
+        std::error_code error;
+        std::filesystem::create_directories(this->directory, error);
+    }
+
+    template<typename T>
+    [[nodiscard]] inline auto make_table(
+        std::string_view name, Placement placement = Placement::Default
+    ) const -> table_t<T>
+    {
+        return MappedTable<T>(directory + "/" + std::string(name) + ".table", placement);
+    }
+};
+
+template<typename... Components>
+using MappedWorld = BasicWorld<MappedStorage, Components...>;
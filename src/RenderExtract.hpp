@@ -0,0 +1,186 @@
+#pragma once
+
+// Render extraction: at the end of a tick the simulation copies what has to be drawn into a compact
+// DrawList, the renderer draws it from another thread while the next tick is simulated.
+// Nothing in here depends on raylib, so the handoff also runs (with a stub consumer) in headless builds.
+
+#include "components.hpp"
+#include "systems.hpp"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct DrawRect {
+    float x, y;
+    // position at the end of the previous tick
+    float previous_x, previous_y;
+    float width, height;
+    CColor color;
+};
+
+struct DrawList {
+    uint64_t tick = 0;
+    // progress towards the next tick when the list was extracted, the rects are drawn that far between
+    // their previous and their current position
+    float alpha = 1;
+    std::vector<DrawRect> rects;
+
+    // player debug overlay
+    bool has_player = false;
+    CPosition player_position {};
+    CVelocity player_velocity {};
+    bool player_colliding = false;
+
+    inline void clear()
+    {
+        rects.clear();
+        has_player = false;
+    }
+};
+
+// Two buffers handed over between a single producer and a single consumer.
+// The producer fills back() then publish()es it, the consumer reads the published one in consume().
+// publish() only waits when the consumer is still reading the previous frame, frames the consumer
+// did not get to are skipped and their buffer reused.
+template<typename T>
+class DoubleBuffer {
+private:
+    std::array<T, 2> buffers;
+    size_t write_index = 0;
+    // the buffer not being written holds a frame the consumer has not seen yet
+    bool ready = false;
+    bool reading = false;
+    bool closed = false;
+    uint64_t published = 0;
+    uint64_t consumed = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    template<typename F>
+    inline auto read_front(std::unique_lock<std::mutex> &lock, F &fn) -> bool
+    {
+        if (!ready) {
+            return false;
+        }
+        ready = false;
+        reading = true;
+        const T &front = buffers[write_index ^ 1];
+        lock.unlock();
+        fn(front);
+        lock.lock();
+        reading = false;
+        consumed++;
+        cv.notify_all();
+        return true;
+    }
+
+public:
+    // only the producer may touch it, until the next publish()
+    [[nodiscard]] inline auto back() -> T & { return buffers[write_index]; }
+
+    inline void publish()
+    {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [this]() { return !reading; });
+        write_index ^= 1;
+        ready = true;
+        published++;
+        cv.notify_all();
+    }
+
+    // waits for a published frame and calls fn(const T &) on it without holding the lock
+    // returns false once the buffer is closed and every frame has been read
+    template<typename F>
+    inline auto consume(F &&fn) -> bool
+    {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [this]() { return ready || closed; });
+        return read_front(lock, fn);
+    }
+
+    // same as consume() but gives up after timeout, for a consumer that has other things to do
+    template<typename F, typename Rep, typename Period>
+    inline auto consume(F &&fn, std::chrono::duration<Rep, Period> timeout) -> bool
+    {
+        std::unique_lock lock(mutex);
+        cv.wait_for(lock, timeout, [this]() { return ready || closed; });
+        return read_front(lock, fn);
+    }
+
+    // wakes up a waiting consumer, consume() returns false from now on once every frame is read
+    inline void close()
+    {
+        std::lock_guard lock(mutex);
+        closed = true;
+        cv.notify_all();
+    }
+
+    [[nodiscard]] inline auto frames_published() -> uint64_t
+    {
+        std::lock_guard lock(mutex);
+        return published;
+    }
+
+    [[nodiscard]] inline auto frames_consumed() -> uint64_t
+    {
+        std::lock_guard lock(mutex);
+        return consumed;
+    }
+};
+
+// Latest input sampled by the render thread (which owns the window), taken by the simulation thread.
+// Spawn is a click and only lasts one frame, it stays set until the simulation has taken it.
+class InputMailbox {
+private:
+    std::mutex mutex;
+    CInput latest {};
+    bool spawn_pending = false;
+
+public:
+    inline void push(const CInput &input)
+    {
+        std::lock_guard lock(mutex);
+        latest = input;
+        spawn_pending = spawn_pending || (input & CInput::Key::Spawn);
+    }
+
+    inline auto take() -> CInput
+    {
+        std::lock_guard lock(mutex);
+        CInput input = latest;
+        if (spawn_pending) {
+            input |= CInput::Key::Spawn;
+            spawn_pending = false;
+        }
+        return input;
+    }
+};
+
+// copies everything the renderer needs, to be run at the end of a tick
+// alpha is FixedTimestep::alpha() after the ticks of the frame
+template<class World>
+void Sextract_draw_list(World &world, DrawList &list, uint64_t tick, float alpha = 1)
+{
+    list.clear();
+    list.tick = tick;
+    list.alpha = alpha;
+    auto group = world.template group<CPosition, CRectangle, CColor>();
+    list.rects.reserve(group.size());
+    group.each([&world, &list](size_t entity, CPosition &pos, CRectangle &rect, CColor &color) {
+        auto [previous] = world.template previous<CPosition>(entity).value();
+        list.rects.push_back({pos.x, pos.y, previous.x, previous.y, rect.width, rect.height, color});
+    });
+    for (auto entity : world.template view<CPlayer, CPosition, CVelocity>()) {
+        if (auto opt = world.template get<CPlayer, CPosition, CVelocity>(entity); opt.has_value()) {
+            auto &[_, pos, velocity] = opt.value();
+            list.has_player = true;
+            list.player_position = pos;
+            list.player_velocity = velocity;
+            list.player_colliding = is_colliding(world, entity);
+        }
+    }
+}
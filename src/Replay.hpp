@@ -0,0 +1,128 @@
+#pragma once
+
+// Deterministic input recording and replay
+// A replay log holds the setup of the run and, for every tick, the timestep, the input applied to the
+// players and a hash of the simulation state after the tick. Replaying it re-runs the exact same
+// simulation headless and reports the first tick whose state differs.
+
+#include "components.hpp"
+#include "utils/fnv.hpp"
+#include "utils/reflect.hpp"
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <type_traits>
+
+struct ReplayHeader {
+    static constexpr std::array<char, 8> expected_magic = {'B', 'E', 'C', 'S', 'R', 'E', 'P', '1'};
+
+    std::array<char, 8> magic = expected_magic;
+    uint32_t version = 1;
+    // extra boxes spawned by init_boxes before the first tick
+    uint32_t entities = 0;
+    uint32_t seed = 42;
+};
+
+struct TickRecord {
+    float dt;
+    CInput::Key key;
+    float cursor_x;
+    float cursor_y;
+    uint64_t state_hash;
+
+    [[nodiscard]] inline auto input() const -> CInput { return CInput {key, cursor_x, cursor_y}; }
+};
+
+// fields are written one by one so the padding of the structs never reaches the file
+class ReplayWriter {
+private:
+    std::ofstream out;
+    uint64_t ticks = 0;
+
+    template<typename T>
+    inline void put(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+public:
+    ReplayWriter(const std::string &path, const ReplayHeader &header):
+        out(path, std::ios::binary | std::ios::trunc)
+    {
+        put(header.magic);
+        put(header.version);
+        put(header.entities);
+        put(header.seed);
+    }
+
+    [[nodiscard]] inline auto is_open() const -> bool { return out.is_open(); }
+    [[nodiscard]] inline auto size() const -> uint64_t { return ticks; }
+
+    inline void write(float dt, const CInput &input, uint64_t state_hash)
+    {
+        put(dt);
+        put(input.key);
+        put(input.x);
+        put(input.y);
+        put(state_hash);
+        ticks++;
+    }
+};
+
+class ReplayReader {
+private:
+    std::ifstream in;
+    ReplayHeader header_ {};
+    bool valid = false;
+
+    template<typename T>
+    inline auto get(T &value) -> bool
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+
+public:
+    explicit ReplayReader(const std::string &path):
+        in(path, std::ios::binary)
+    {
+        valid = get(header_.magic) && get(header_.version) && get(header_.entities) && get(header_.seed) &&
+                header_.magic == ReplayHeader::expected_magic && header_.version == ReplayHeader {}.version;
+    }
+
+    // false when the file is missing, truncated or not a replay
+    [[nodiscard]] inline auto is_valid() const -> bool { return valid; }
+    [[nodiscard]] inline auto header() const -> const ReplayHeader & { return header_; }
+
+    // reads the next tick, false at the end of the log
+    inline auto next(TickRecord &record) -> bool
+    {
+        return valid && get(record.dt) && get(record.key) && get(record.cursor_x) && get(record.cursor_y) &&
+               get(record.state_hash);
+    }
+};
+
+// FNV-1a over the id and the fields of the Cs of every alive entity, in id order
+// hashing the reflected fields rather than the object bytes keeps padding out of the hash
+template<reflect::Reflected... Cs, class World>
+auto state_hash(World &world) -> uint64_t
+{
+    fnv::Hasher hash;
+    for (auto entity : world) {
+        hash.mix_value(entity);
+        (
+            [&]() {
+                if (auto opt = world.template get<Cs>(entity); opt.has_value()) {
+                    const Cs &component = std::get<0>(opt.value());
+                    reflect::for_each_field<Cs>([&](const auto &field) {
+                        hash.mix_value(field.get(component));
+                    });
+                }
+            }(),
+            ...
+        );
+    }
+    return hash.value();
+}
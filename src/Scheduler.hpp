@@ -0,0 +1,186 @@
+#pragma once
+
+// Coroutine tasks driven by the simulation clock
+// A Task is a coroutine that runs across ticks: `co_await scheduler.wait(seconds)` and
+// `co_await scheduler.next_tick()` suspend it until the clock gets there. Sleeping tasks sit in a timer
+// wheel and cost nothing until they are due, advance() only touches the tasks of the current tick.
+// e.g. Task blink(Scheduler &s) { for (;;) { toggle(); co_await s.wait(0.5f); } }; s.spawn(blink(s));
+// Entity ids do not survive a sort_by, a task looks its entities up again after every wait.
+
+#include "utils/profiler.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <utility>
+#include <vector>
+
+class Task {
+public:
+    struct promise_type {
+        inline auto get_return_object() -> Task
+        {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        // started by Scheduler::spawn, finished tasks are destroyed by the scheduler
+        inline auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+        inline auto final_suspend() noexcept -> std::suspend_always { return {}; }
+        inline void return_void() {}
+        inline void unhandled_exception() { std::terminate(); }
+    };
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Task(std::coroutine_handle<promise_type> handle):
+        handle(handle)
+    {
+    }
+
+public:
+    Task(const Task &) = delete;
+    auto operator=(const Task &) -> Task & = delete;
+
+    Task(Task &&other) noexcept:
+        handle(std::exchange(other.handle, nullptr))
+    {
+    }
+
+    auto operator=(Task &&other) noexcept -> Task &
+    {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+
+    // a task that was never spawned
+    ~Task()
+    {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    [[nodiscard]] inline auto release() -> std::coroutine_handle<> { return std::exchange(handle, nullptr); }
+};
+
+// Hashed timer wheel over ticks: a task due in less than wheelSize ticks waits in the slot of its tick,
+// later ones wait in a heap and move into the wheel when they get close. Every slot only holds tasks of
+// a single tick, so advancing resumes a whole slot without looking at anything else.
+// Tasks due on the same tick are resumed in the order they were suspended, replays depend on it.
+class Scheduler {
+private:
+    static constexpr uint64_t wheelSize = 256;
+
+    struct Timer {
+        uint64_t deadline;
+        // suspension order, breaks deadline ties in the heap
+        uint64_t sequence;
+        std::coroutine_handle<> handle;
+
+        // std::push_heap builds a max heap, the earliest timer has to come out first
+        [[nodiscard]] inline auto operator>(const Timer &other) const -> bool
+        {
+            return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+        }
+    };
+
+    float tick_length;
+    uint64_t now_ = 0;
+    uint64_t sequence = 0;
+    size_t pending = 0;
+    std::array<std::vector<Timer>, wheelSize> wheel;
+    std::vector<Timer> far;
+    // the slot being resumed, swapped out so resumed tasks can schedule while it is walked
+    std::vector<Timer> due;
+
+    inline void schedule(std::coroutine_handle<> handle, uint64_t ticks)
+    {
+        Timer timer {now_ + std::max<uint64_t>(ticks, 1), sequence++, handle};
+        if (timer.deadline - now_ < wheelSize) {
+            wheel[timer.deadline % wheelSize].push_back(timer);
+        } else {
+            far.push_back(timer);
+            std::push_heap(far.begin(), far.end(), std::greater<> {});
+        }
+        pending++;
+    }
+
+    static inline void resume(std::coroutine_handle<> handle)
+    {
+        handle.resume();
+        if (handle.done()) {
+            handle.destroy();
+        }
+    }
+
+public:
+    struct Wait {
+        Scheduler &scheduler;
+        uint64_t ticks;
+
+        [[nodiscard]] inline auto await_ready() const noexcept -> bool { return false; }
+        inline void await_suspend(std::coroutine_handle<> handle) { scheduler.schedule(handle, ticks); }
+        inline void await_resume() const noexcept {}
+    };
+
+    // tick_length is the timestep in seconds the simulation advances by on every tick
+    explicit Scheduler(float tick_length):
+        tick_length(tick_length)
+    {
+    }
+
+    // tasks hold a reference to their scheduler
+    Scheduler(const Scheduler &) = delete;
+    auto operator=(const Scheduler &) -> Scheduler & = delete;
+
+    // tasks still waiting are destroyed where they are suspended
+    ~Scheduler()
+    {
+        for (auto &slot : wheel) {
+            for (const auto &timer : slot) {
+                timer.handle.destroy();
+            }
+        }
+        for (const auto &timer : far) {
+            timer.handle.destroy();
+        }
+    }
+
+    // runs the task until its first wait
+    inline void spawn(Task task) { resume(task.release()); }
+
+    // resumes on the first tick at least seconds from now, rounded up to whole ticks
+    [[nodiscard]] inline auto wait(float seconds) -> Wait
+    {
+        return Wait {*this, static_cast<uint64_t>(std::max(0.0f, std::ceil(seconds / tick_length)))};
+    }
+
+    [[nodiscard]] inline auto next_tick() -> Wait { return Wait {*this, 1}; }
+
+    // moves the clock one tick forward and resumes the tasks due on it
+    inline void advance()
+    {
+        PROFILE_ZONE("Scheduler::advance");
+        now_++;
+        while (!far.empty() && far.front().deadline - now_ < wheelSize) {
+            std::pop_heap(far.begin(), far.end(), std::greater<> {});
+            wheel[far.back().deadline % wheelSize].push_back(far.back());
+            far.pop_back();
+        }
+        due.swap(wheel[now_ % wheelSize]);
+        pending -= due.size();
+        for (const auto &timer : due) {
+            resume(timer.handle);
+        }
+        due.clear();
+    }
+
+    // ticks advanced so far
+    [[nodiscard]] inline auto now() const -> uint64_t { return now_; }
+    // tasks waiting on the clock
+    [[nodiscard]] inline auto size() const -> size_t { return pending; }
+};
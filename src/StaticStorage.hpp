@@ -0,0 +1,75 @@
+#pragma once
+
+// Fixed capacity storage for worlds that must never touch the allocator once built.
+// Every table is a std::array of MaxEntities slots inside the world object: the tables never grow,
+// spawning past the limit fails (try_new_entity() returns nullopt) instead of reallocating.
+// The world is as big as its tables, World::footprint(MaxEntities) bytes, keep it off the stack:
+// e.g. static StaticWorld<4096, CPosition, CVelocity> world;
+//      static_assert(decltype(world)::footprint(4096) <= 1 << 20);
+// Still allocating: the bit columns (once, when the world is built), a group the first time it is
+// used, event channels until they reach their steady size, and sort_by.
+
+#include "World.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+// MaxEntities slots of T, the part of the std::vector interface the world uses
+// size() is the part in use, resize() only moves it and never past the capacity
+template<typename T, size_t MaxEntities>
+class StaticTable {
+private:
+    std::array<T, MaxEntities> slots {};
+    size_t count = 0;
+
+public:
+    StaticTable() = default;
+
+    // new elements are value initialized
+    inline void resize(size_t new_count)
+    {
+        if (new_count > MaxEntities) {
+            std::cerr << "StaticTable: " << new_count << " elements requested, the capacity is "
+                      << MaxEntities << "\n";
+            std::abort();
+        }
+        if (new_count > count) {
+            std::fill(slots.begin() + count, slots.begin() + new_count, T {});
+        }
+        count = new_count;
+    }
+
+    [[nodiscard]] inline auto operator[](size_t idx) -> T & { return slots[idx]; }
+    [[nodiscard]] inline auto operator[](size_t idx) const -> const T & { return slots[idx]; }
+    [[nodiscard]] inline auto data() -> T * { return slots.data(); }
+    [[nodiscard]] inline auto size() const -> size_t { return count; }
+    [[nodiscard]] inline auto empty() const -> bool { return count == 0; }
+    [[nodiscard]] static constexpr auto capacity() -> size_t { return MaxEntities; }
+    [[nodiscard]] inline auto begin() -> T * { return slots.data(); }
+    [[nodiscard]] inline auto end() -> T * { return slots.data() + count; }
+    [[nodiscard]] inline auto begin() const -> const T * { return slots.data(); }
+    [[nodiscard]] inline auto end() const -> const T * { return slots.data() + count; }
+};
+
+template<size_t MaxEntities>
+struct StaticStorage {
+    template<typename T>
+    using table_t = StaticTable<T, MaxEntities>;
+
+    static constexpr bool copies_on_growth = false;
+    static constexpr bool persistent = false;
+    // the world sizes its tables to it once and never grows them
+    static constexpr size_t max_capacity = MaxEntities;
+
+    template<typename T>
+    [[nodiscard]] inline auto make_table(std::string_view, Placement = Placement::Default) const -> table_t<T>
+    {
+        return {};
+    }
+};
+
+template<size_t MaxEntities, typename... Components>
+using StaticWorld = BasicWorld<StaticStorage<MaxEntities>, Components...>;
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "ComponentTraits.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// Storage policies decide what holds the component tables and the status of a BasicWorld.
+// A policy provides:
+// - table_t<T>: a contiguous table with operator[], size(), empty(), capacity(), resize(), begin() and end()
+// - make_table<T>(name, placement): an empty (or, for persistent storages, previously saved) table, placed
+//   as component_traits asks for component tables (Placement::Default for the status)
+// - copies_on_growth: whether resize() copies the existing elements (for the growth statistics)
+// - persistent: whether the tables outlive the world, the world then saves its counters with them
+
+// Allocator of the vector tables, the placement travels with the table (copies, moves and swaps)
+// Hot tables start on a cache line, from a huge page when they span at least one, cold ones are advised
+// out of transparent huge pages. The advice is Linux only, elsewhere only the alignment changes.
+template<typename T>
+class PlacedAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    static constexpr size_t cacheLineSize = 64;
+    static constexpr size_t hugePageSize = size_t {2} << 20;
+    static constexpr size_t pageSize = 4096;
+
+    Placement placement = Placement::Default;
+
+    PlacedAllocator() = default;
+
+    explicit PlacedAllocator(Placement placement):
+        placement(placement)
+    {
+    }
+
+    template<typename U>
+    PlacedAllocator(const PlacedAllocator<U> &other) noexcept:
+        placement(other.placement)
+    {
+    }
+
+    [[nodiscard]] inline auto allocate(size_t count) -> T *
+    {
+        size_t bytes = count * sizeof(T);
+        void *data = ::operator new(bytes, std::align_val_t {alignment(bytes)});
+        advise(data, bytes);
+        return static_cast<T *>(data);
+    }
+
+    inline void deallocate(T *data, size_t count) noexcept
+    {
+        size_t bytes = count * sizeof(T);
+        ::operator delete(data, bytes, std::align_val_t {alignment(bytes)});
+    }
+
+    template<typename U>
+    inline auto operator==(const PlacedAllocator<U> &other) const -> bool
+    {
+        return placement == other.placement;
+    }
+
+private:
+    [[nodiscard]] inline auto alignment(size_t bytes) const -> size_t
+    {
+        if (placement != Placement::Hot) {
+            return std::max(alignof(T), size_t {__STDCPP_DEFAULT_NEW_ALIGNMENT__});
+        }
+        return std::max(alignof(T), bytes >= hugePageSize ? hugePageSize : cacheLineSize);
+    }
+
+    // only the whole pages inside the allocation are advised, the rest belongs to other allocations
+    inline void advise(void *data, size_t bytes) const
+    {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+        size_t page = placement == Placement::Hot ? hugePageSize : pageSize;
+        if (placement == Placement::Default || bytes < page) {
+            return;
+        }
+        auto begin = (reinterpret_cast<uintptr_t>(data) + page - 1) / page * page;
+        auto end = (reinterpret_cast<uintptr_t>(data) + bytes) / page * page;
+        if (begin < end) {
+            ::madvise(
+                reinterpret_cast<void *>(begin), end - begin,
+                placement == Placement::Hot ? MADV_HUGEPAGE : MADV_NOHUGEPAGE
+            );
+        }
+#else
+        static_cast<void>(data);
+        static_cast<void>(bytes);
+#endif
+    }
+};
+
+// default storage, tables are std::vectors
+struct VectorStorage {
+    template<typename T>
+    using table_t = std::vector<T, PlacedAllocator<T>>;
+
+    static constexpr bool copies_on_growth = true;
+    static constexpr bool persistent = false;
+
+    template<typename T>
+    [[nodiscard]] inline auto make_table(std::string_view, Placement placement = Placement::Default) const
+        -> table_t<T>
+    {
+        return table_t<T>(PlacedAllocator<T>(placement));
+    }
+};
@@ -0,0 +1,305 @@
+#pragma once
+
+// Spatial streaming for maps larger than what has to be simulated
+// The map is cut into square cells. update() packs the entities of the cells farther than the active
+// radius from every focus (the players) into a compact blob and deletes them from the world, so views
+// and groups only ever walk what is near a player. Once a stored cell is back in range its blobs are
+// decoded on a background thread and the next update() spawns the entities back in one batch per cell
+// (add_bulk per component, observers get one notification per batch).
+// Only the entities whose components are all saved (P, the position, and Cs) are streamed, the others
+// (players, attached entities, ...) always stay in the world. Ids are not kept, an entity comes back
+// under a new id: references held outside the world have to be dropped (e.g. with an on_delete observer).
+//
+// Blob of a cell: uint32 count, then for P and each of Cs in order: a presence bitmap of count bits
+// (rounded up to bytes) and the reflected fields of the present components, packed without padding.
+
+#include "utils/profiler.hpp"
+#include "utils/reflect.hpp"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template<typename P, typename... Cs>
+class CellStreamer {
+public:
+    struct Cell {
+        int32_t x;
+        int32_t y;
+
+        inline auto operator<=>(const Cell &other) const = default;
+    };
+
+private:
+    template<typename C>
+    static constexpr bool streamable = reflect::Reflected<C> && std::is_default_constructible_v<C>;
+    static_assert((streamable<P> && ... && streamable<Cs>), "streamed components need reflected fields");
+
+    // decoded components of a cell, rows index the entities of the blob
+    template<typename C>
+    struct Column {
+        std::vector<uint32_t> rows;
+        std::vector<C> values;
+    };
+
+    struct Batch {
+        Cell cell;
+        uint32_t count = 0;
+        std::tuple<Column<P>, Column<Cs>...> columns;
+    };
+
+    float cell_size;
+    int32_t radius;
+    // cells out of the world, every unload of a cell appends a blob
+    std::map<Cell, std::vector<std::vector<std::byte>>> stored;
+    size_t stored_bytes_ = 0;
+
+    // blobs waiting for the loader, and the batches it decoded
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::pair<Cell, std::vector<std::vector<std::byte>>>> requests;
+    std::vector<Batch> decoded;
+    size_t in_flight = 0;
+    bool stopping = false;
+    std::jthread loader;
+
+    template<typename T>
+    static inline void put(std::vector<std::byte> &out, const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto *bytes = reinterpret_cast<const std::byte *>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename T>
+    static inline void take(const std::byte *&in, T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        std::memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+    }
+
+    template<typename C, class World>
+    static void encode_column(std::vector<std::byte> &out, World &world, std::span<const size_t> entities)
+    {
+        size_t bitmap = out.size();
+        out.resize(out.size() + (entities.size() + 7) / 8);
+        for (size_t i = 0; i < entities.size(); i++) {
+            if (auto opt = world.template get<C>(entities[i]); opt.has_value()) {
+                out[bitmap + i / 8] |= std::byte {1} << (i % 8);
+                const C &component = std::get<0>(opt.value());
+                reflect::for_each_field<C>([&](const auto &field) { put(out, field.get(component)); });
+            }
+        }
+    }
+
+    template<typename C>
+    static void decode_column(const std::byte *&in, uint32_t first, uint32_t count, Column<C> &column)
+    {
+        const std::byte *bitmap = in;
+        in += (count + 7) / 8;
+        for (uint32_t i = 0; i < count; i++) {
+            if ((bitmap[i / 8] & (std::byte {1} << (i % 8))) == std::byte {0}) {
+                continue;
+            }
+            C component {};
+            reflect::for_each_field<C>([&](const auto &field) { take(in, field.get(component)); });
+            column.rows.push_back(first + i);
+            column.values.push_back(component);
+        }
+    }
+
+    // runs on the loader thread
+    static auto decode(Cell cell, const std::vector<std::vector<std::byte>> &blobs) -> Batch
+    {
+        Batch batch {cell, 0, {}};
+        for (const auto &blob : blobs) {
+            const std::byte *in = blob.data();
+            uint32_t count = 0;
+            take(in, count);
+            std::apply(
+                [&](auto &...column) { (decode_column(in, batch.count, count, column), ...); }, batch.columns
+            );
+            batch.count += count;
+        }
+        return batch;
+    }
+
+    // decodes the requested cells until the streamer is destroyed, the cells still queued then are dropped
+    inline void load_loop()
+    {
+        std::unique_lock lock(mutex);
+        while (true) {
+            cv.wait(lock, [this]() { return stopping || !requests.empty(); });
+            if (stopping) {
+                return;
+            }
+            auto [cell, blobs] = std::move(requests.front());
+            requests.pop_front();
+            lock.unlock();
+            Batch batch = decode(cell, blobs);
+            lock.lock();
+            decoded.push_back(std::move(batch));
+            in_flight--;
+            cv.notify_all();
+        }
+    }
+
+    template<class World>
+    inline void spawn(World &world, Batch &batch)
+    {
+        std::vector<size_t> ids(batch.count);
+        for (auto &id : ids) {
+            id = world.new_entity();
+        }
+        std::vector<size_t> targets;
+        std::apply(
+            [&]<typename... Columns>(Columns &...column) {
+                (
+                    [&]() {
+                        using C = typename decltype(column.values)::value_type;
+                        targets.clear();
+                        for (uint32_t row : column.rows) {
+                            targets.push_back(ids[row]);
+                        }
+                        world.template add_bulk<C>(targets, column.values);
+                    }(),
+                    ...
+                );
+            },
+            batch.columns
+        );
+    }
+
+    [[nodiscard]] inline auto cell_of(const P &pos) const -> Cell
+    {
+        return Cell {
+            static_cast<int32_t>(std::floor(pos.x / cell_size)),
+            static_cast<int32_t>(std::floor(pos.y / cell_size)),
+        };
+    }
+
+    [[nodiscard]] inline auto in_range(Cell cell, std::span<const Cell> centers) const -> bool
+    {
+        return std::any_of(centers.begin(), centers.end(), [this, cell](Cell center) {
+            return std::abs(cell.x - center.x) <= radius && std::abs(cell.y - center.y) <= radius;
+        });
+    }
+
+public:
+    // cells are cell_size wide, the ones at most radius cells away (on both axes) from a focus stay loaded
+    CellStreamer(float cell_size, int32_t radius):
+        cell_size(cell_size),
+        radius(radius),
+        loader([this]() { load_loop(); })
+    {
+    }
+
+    // the loader thread points at the streamer
+    CellStreamer(const CellStreamer &) = delete;
+    auto operator=(const CellStreamer &) -> CellStreamer & = delete;
+
+    ~CellStreamer()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+    }
+
+    // spawns the cells decoded since the last call, stores the cells out of range of every focus and
+    // hands the stored cells back in range to the loader
+    template<class World>
+    inline void update(World &world, std::span<const P> focus)
+    {
+        PROFILE_ZONE("CellStreamer::update");
+        merge(world);
+
+        std::vector<Cell> centers;
+        for (const auto &pos : focus) {
+            centers.push_back(cell_of(pos));
+        }
+        std::map<Cell, std::vector<size_t>> leaving;
+        for (auto entity : world.template view<P>()) {
+            if (!world.template has_only<P, Cs...>(entity)) {
+                continue;
+            }
+            auto [pos] = world.template get<P>(entity).value();
+            Cell cell = cell_of(pos);
+            if (!in_range(cell, centers)) {
+                leaving[cell].push_back(entity);
+            }
+        }
+        for (const auto &[cell, entities] : leaving) {
+            std::vector<std::byte> blob;
+            put(blob, static_cast<uint32_t>(entities.size()));
+            encode_column<P>(blob, world, entities);
+            (encode_column<Cs>(blob, world, entities), ...);
+            stored_bytes_ += blob.size();
+            stored[cell].push_back(std::move(blob));
+            for (size_t entity : entities) {
+                world.delete_entity(entity);
+            }
+        }
+
+        std::lock_guard lock(mutex);
+        for (Cell center : centers) {
+            for (int32_t y = center.y - radius; y <= center.y + radius; y++) {
+                for (int32_t x = center.x - radius; x <= center.x + radius; x++) {
+                    auto found = stored.find(Cell {x, y});
+                    if (found == stored.end()) {
+                        continue;
+                    }
+                    for (const auto &blob : found->second) {
+                        stored_bytes_ -= blob.size();
+                    }
+                    requests.emplace_back(found->first, std::move(found->second));
+                    stored.erase(found);
+                    in_flight++;
+                }
+            }
+        }
+        cv.notify_all();
+    }
+
+    // spawns the cells the loader has finished, without waiting for the others
+    template<class World>
+    inline void merge(World &world)
+    {
+        std::vector<Batch> ready;
+        {
+            std::lock_guard lock(mutex);
+            ready.swap(decoded);
+        }
+        for (auto &batch : ready) {
+            spawn(world, batch);
+        }
+    }
+
+    // waits for every requested cell and spawns them, for runs that have to be deterministic
+    template<class World>
+    inline void flush(World &world)
+    {
+        {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [this]() { return in_flight == 0; });
+        }
+        merge(world);
+    }
+
+    // cells and bytes kept out of the world
+    [[nodiscard]] inline auto stored_cells() const -> size_t { return stored.size(); }
+    [[nodiscard]] inline auto stored_bytes() const -> size_t { return stored_bytes_; }
+};
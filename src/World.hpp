@@ -2,51 +2,702 @@
 #pragma once
 
 #include "ComponentStatus.hpp"
+#include "Events.hpp"
+#include "Storage.hpp"
+#include "WorldStats.hpp"
+#include "utils/debug.hpp"
+#include "utils/fnv.hpp"
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
 #include <algorithm> // for std::find_if
 #include <array>
+#include <atomic>
+#include <bit>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 #include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <variant>
 #include <vector>
 
-template<typename... Components>
+using Entity = size_t;
+
+// How a view walks the entities, see World::plan()
+struct QueryPlan {
+    enum class Kind {
+        // every slot below the high-water mark is tested
+        Scan,
+        // only the set bits of the driver's column are tested
+        Column,
+    };
+
+    Kind kind;
+    std::string_view driver;
+    // entities having the driver component, the most selective one of the view
+    size_t candidates;
+    // slots a scan would test
+    size_t range;
+
+    friend auto operator<<(std::ostream &os, const QueryPlan &plan) -> std::ostream &
+    {
+        return os << (plan.kind == Kind::Scan ? "scan" : "column") << " driven by " << plan.driver << ", "
+                  << plan.candidates << " candidates out of " << plan.range;
+    }
+};
+
+// Storage is the policy holding the component tables and the status, see Storage.hpp
+template<class Storage, typename... Components>
     requires are_types_unique_v<Components...>
-class World {
+class BasicWorld {
 public:
     class Exist;
 
     template<typename T>
     static constexpr bool are_from_components_v = (std::is_same_v<T, Components> || ...);
 
+    // indexes owned by the world (groups)
     template<typename T>
     using container_t = std::vector<T>;
 
-    using tables_t = std::tuple<container_t<Components>...>;
-    using status_table_t = container_t<ComponentStatus<Exist, Components...>>;
+    // component tables and status, provided by the storage
+    template<typename T>
+    using table_t = typename Storage::template table_t<T>;
+
+    // a component that can not be default constructed lives in an optional, built by add or emplace
+    template<typename C>
+    using slot_t = std::conditional_t<std::is_default_constructible_v<C>, C, std::optional<C>>;
+
+    template<typename C>
+    using component_table_t = table_t<slot_t<C>>;
+
+    using storage_t = Storage;
+    // called with the entities concerned by a structural change, one span per change or per bulk batch
+    using Observer = std::function<void(std::span<const Entity>)>;
+    // returned by on_add, on_remove and on_delete, for unobserve()
+    using ObserverId = size_t;
+    using tables_t = std::tuple<component_table_t<Components>...>;
+    // the values of the buffered components at the end of the previous tick, nothing for the others
+    template<typename C>
+    using previous_table_t = std::conditional_t<buffered_v<C>, component_table_t<C>, std::monostate>;
+    using previous_tables_t = std::tuple<previous_table_t<Components>...>;
+    using status_t = ComponentStatus<Exist, Components...>;
+    using status_table_t = table_t<status_t>;
 
 private:
     static constexpr size_t defaultTableCapacity = 8;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t number_of_components = sizeof...(Components);
+
+public:
+    // capacity of a fixed storage (see StaticStorage.hpp), npos when the tables grow on demand
+    static constexpr size_t max_capacity = []() {
+        if constexpr (requires { Storage::max_capacity; }) {
+            return Storage::max_capacity;
+        } else {
+            return npos;
+        }
+    }();
+    static constexpr bool fixed_capacity = max_capacity != npos;
+
+    // lookups get_many and each_many prefetch ahead, enough to cover a memory access with a few rows
+    // of work each (measured with the gather/ benchmarks)
+    static constexpr size_t defaultPrefetchDistance = 8;
+
+    // bytes of the tables (previous ones included), status and bit columns for capacity entities
+    // (groups and events excluded)
+    static constexpr auto footprint(size_t capacity) -> size_t
+    {
+        return capacity * (sizeof(status_t) + (sizeof(slot_t<Components>) + ...) +
+                           ((buffered_v<Components> ? sizeof(slot_t<Components>) : 0) + ...)) +
+               number_of_components * ((capacity + 63) / 64) * sizeof(uint64_t);
+    }
+
+private:
+    // a view is driven by a column when at most 1 / columnSelectivity of the range has the component
+    static constexpr size_t columnSelectivity = 4;
+
+    template<typename C>
+    static constexpr size_t component_index = []() {
+        size_t i = 0;
+        ((std::is_same_v<C, Components> ? false : (++i, true)) && ...);
+        return i;
+    }();
+
+    // one bit per slot, set when the slot holds an alive entity having the component
+    using column_t = container_t<uint64_t>;
+
+    // packed list of the entities having a full signature, kept up to date by add/remove/delete
+    // entities are stored by index in every table, so the group packs the ids and not the components
+    struct Group {
+        typename status_t::storage_type signature;
+        container_t<size_t> entities;
+        // index of each entity inside entities, npos when not a member
+        container_t<size_t> positions;
+    };
+
+    struct ObserverSlot {
+        ObserverId id;
+        Observer fn;
+    };
+
+    // the list of a component is picked at compile time, an unobserved component costs a bit test
+    // observers are not copied with the world, they hold references to caches of the original
+    struct Observers {
+        std::array<container_t<ObserverSlot>, number_of_components> added;
+        std::array<container_t<ObserverSlot>, number_of_components> removed;
+        container_t<ObserverSlot> deleted;
+        // status bits of the components having added or removed observers, tested by the add and remove paths
+        typename status_t::storage_type adding = 0;
+        typename status_t::storage_type removing = 0;
+        ObserverId next_id = 0;
+        // entities of the batch being dispatched, reused across batches
+        container_t<Entity> batch;
+
+        Observers() = default;
+        Observers(const Observers &) {}
+        Observers(Observers &&) noexcept = default;
+        auto operator=(const Observers &) -> Observers & { return *this; }
+        auto operator=(Observers &&) noexcept -> Observers & = default;
+        ~Observers() = default;
+    };
+
+    // counters saved along the tables of a persistent storage, layout tells apart incompatible worlds
+    struct Metadata {
+        uint64_t layout;
+        uint64_t capacity;
+        uint64_t entities;
+        uint64_t high_water_mark;
+    };
 
     status_table_t status;
     tables_t tables;
+    previous_tables_t previous_tables;
+    // one element, only persistent storages have it
+    std::conditional_t<Storage::persistent, table_t<Metadata>, std::monostate> metadata;
     size_t tables_capacity = defaultTableCapacity;
     size_t number_of_entities = 0;
+    // one past the highest slot ever handed out, iteration never needs to look further
+    size_t high_water_mark = 0;
+    // every slot below it is alive, new_entity starts looking for a free slot there
+    size_t first_free = 0;
+    // sort_by pass in progress: order[slot] is the id of the entity to place at slot, rank the reverse
+    // (npos for the entities the pass does not know), the slots below cursor are placed
+    struct SortPass {
+        std::vector<size_t> order;
+        std::vector<size_t> rank;
+        size_t cursor = 0;
+    };
+    SortPass sort_pass;
+    // a deque keeps the groups in place when another one is declared, views hold on to their members
+    std::deque<Group> groups;
+    // per component: number of alive entities having it and their bit column, used to plan views
+    std::array<size_t, number_of_components> live_counts {};
+    std::array<column_t, number_of_components> columns;
+    size_t growth_events = 0;
+    size_t growth_bytes_copied = 0;
+    EventRegistry channels;
+    Observers observers;
+#ifdef BECS_PROFILE
+    // per component: get and group each count as reads, add, emplace and remove as writes
+    struct AccessCounts {
+        uint64_t reads;
+        uint64_t writes;
+    };
+    std::array<AccessCounts, number_of_components> tick_access {};
+    std::array<AccessCounts, number_of_components> total_access {};
+    size_t access_ticks = 0;
+#endif
 
 private:
     void increase_capacity(size_t new_capacity)
     {
-        std::cout << "Increasing capacity " << tables_capacity << " to " << new_capacity << std::endl;
+        PROFILE_ZONE("World::increase_capacity");
+        LOG_DEBUG("Increasing capacity ", tables_capacity, " to ", new_capacity);
+        if (!status.empty()) {
+            growth_events++;
+            if constexpr (Storage::copies_on_growth) {
+                size_t row = sizeof(status_t) + (sizeof(slot_t<Components>) + ...) +
+                             ((buffered_v<Components> ? sizeof(slot_t<Components>) : 0) + ...);
+                growth_bytes_copied += status.size() * row;
+            }
+        }
         tables_capacity = new_capacity;
-        (std::get<container_t<Components>>(tables).resize(tables_capacity), ...);
+        (table<Components>().resize(tables_capacity), ...);
+        (
+            [&]() {
+                if constexpr (buffered_v<Components>) {
+                    previous_table<Components>().resize(tables_capacity);
+                }
+            }(),
+            ...
+        );
         status.resize(tables_capacity);
+        for (auto &group : groups) {
+            group.positions.resize(tables_capacity, npos);
+        }
+        for (auto &column : columns) {
+            column.resize((tables_capacity + 63) / 64, 0);
+        }
+    }
+
+    template<typename C>
+    inline void column_set(size_t idx)
+    {
+        constexpr size_t i = component_index<C>;
+        columns[i][idx / 64] |= uint64_t {1} << (idx % 64);
+        live_counts[i]++;
+    }
+
+    template<typename C>
+    inline void column_clear(size_t idx)
+    {
+        constexpr size_t i = component_index<C>;
+        columns[i][idx / 64] &= ~(uint64_t {1} << (idx % 64));
+        live_counts[i]--;
+    }
+
+    // brings the columns and counts of idx in line with its status, for writes that bypassed them
+    inline void columns_sync(size_t idx)
+    {
+        bool alive = status[idx].template isActive<Exist>();
+        (
+            [&]() {
+                bool active = alive && status[idx].template isActive<Components>();
+                bool set = ((columns[component_index<Components>][idx / 64] >> (idx % 64)) & 1) != 0;
+                if (active && !set) {
+                    column_set<Components>(idx);
+                } else if (!active && set) {
+                    column_clear<Components>(idx);
+                }
+            }(),
+            ...
+        );
+    }
+
+    template<typename C>
+    [[nodiscard]] inline auto table() -> component_table_t<C> &
+    {
+        return std::get<component_table_t<C>>(tables);
+    }
+
+    template<typename C>
+    [[nodiscard]] inline auto table() const -> const component_table_t<C> &
+    {
+        return std::get<component_table_t<C>>(tables);
+    }
+
+    template<typename C>
+    [[nodiscard]] inline auto previous_table() -> component_table_t<C> &
+    {
+        return std::get<component_index<C>>(previous_tables);
+    }
+
+    template<typename C>
+    [[nodiscard]] inline auto previous_table() const -> const component_table_t<C> &
+    {
+        return std::get<component_index<C>>(previous_tables);
+    }
+
+    // a component added during a tick has no previous value yet, it starts from the one it was added with
+    template<typename C>
+    inline void init_previous([[maybe_unused]] size_t idx)
+    {
+        if constexpr (buffered_v<C>) {
+            previous_table<C>()[idx] = table<C>()[idx];
+        }
+    }
+
+    // the component stored for idx, which must have it
+    template<typename C>
+    [[nodiscard]] inline auto component(size_t idx) -> C &
+    {
+        if constexpr (std::is_default_constructible_v<C>) {
+            return table<C>()[idx];
+        } else {
+            return *table<C>()[idx];
+        }
+    }
+
+    template<typename C>
+    [[nodiscard]] inline auto previous_component(size_t idx) const -> const C &
+    {
+        if constexpr (std::is_default_constructible_v<C>) {
+            return previous_table<C>()[idx];
+        } else {
+            return *previous_table<C>()[idx];
+        }
+    }
+
+    // destroys the component of a slot that is losing it, only optional slots own anything
+    template<typename C>
+    inline void release(size_t idx)
+    {
+        if constexpr (!std::is_default_constructible_v<C>) {
+            table<C>()[idx].reset();
+            if constexpr (buffered_v<C>) {
+                previous_table<C>()[idx].reset();
+            }
+        }
+    }
+
+    template<typename C>
+    inline void count_reads([[maybe_unused]] size_t count)
+    {
+#ifdef BECS_PROFILE
+        tick_access[component_index<C>].reads += count;
+#endif
+    }
+
+    template<typename C>
+    inline void count_writes([[maybe_unused]] size_t count)
+    {
+#ifdef BECS_PROFILE
+        tick_access[component_index<C>].writes += count;
+#endif
+    }
+
+    // kept out of line, the add and remove paths stay as small as they were
+    [[gnu::noinline]] static void notify(
+        const container_t<ObserverSlot> &slots, std::span<const Entity> entities
+    )
+    {
+        for (const auto &slot : slots) {
+            slot.fn(entities);
+        }
+    }
+
+    [[gnu::noinline]] static void notify(const container_t<ObserverSlot> &slots, Entity entity)
+    {
+        notify(slots, std::span<const Entity>(&entity, 1));
+    }
+
+    // on_remove observers of every component of idx, then the on_delete ones
+    inline void notify_delete(size_t idx)
+    {
+        (
+            [&]() {
+                const auto &removed = observers.removed[component_index<Components>];
+                if (!removed.empty() && status[idx].template isActive<Components>()) {
+                    notify(removed, idx);
+                }
+            }(),
+            ...
+        );
+        notify(observers.deleted, idx);
+    }
+
+    // the alive entities having all of Cs into observers.batch
+    template<typename... Cs>
+    inline auto collect_batch(size_t from, size_t to) -> std::span<const Entity>
+    {
+        observers.batch.clear();
+        for (size_t idx = from; idx < to; idx++) {
+            if (matches<Cs...>(idx)) {
+                observers.batch.push_back(idx);
+            }
+        }
+        return observers.batch;
+    }
+
+    // bookkeeping once the component of idx is stored
+    template<typename C>
+    inline void on_added(size_t idx)
+    {
+        count_writes<C>(1);
+        bool added = !status[idx].template isActive<C>();
+        if (added) {
+            status[idx].template activate<C>();
+            column_set<C>(idx);
+            init_previous<C>(idx);
+        }
+        groups_on_add(idx, status_t::template mask<C>);
+        if (added && (observers.adding & status_t::template mask<C>) != 0) [[unlikely]] {
+            notify(observers.added[component_index<C>], idx);
+        }
+    }
+
+    // first slot at or after idx whose bit is set in column, limit if there is none before it
+    static inline auto column_next(const column_t &column, size_t idx, size_t limit) -> size_t
+    {
+        if (idx >= limit) {
+            return limit;
+        }
+        size_t word = idx / 64;
+        size_t words = (limit + 63) / 64;
+        uint64_t bits = column[word] & (~uint64_t {0} << (idx % 64));
+        while (bits == 0) {
+            if (++word >= words) {
+                return limit;
+            }
+            bits = column[word];
+        }
+        return std::min(word * 64 + static_cast<size_t>(std::countr_zero(bits)), limit);
+    }
+
+    inline void group_insert(Group &group, size_t idx)
+    {
+        group.positions[idx] = group.entities.size();
+        group.entities.push_back(idx);
+    }
+
+    // swap and pop, the last member takes the place of the removed one
+    inline void group_erase(Group &group, size_t idx)
+    {
+        size_t pos = group.positions[idx];
+        size_t last = group.entities.back();
+        group.entities[pos] = last;
+        group.positions[last] = pos;
+        group.entities.pop_back();
+        group.positions[idx] = npos;
+    }
+
+    // called after a component bit was set on idx
+    inline void groups_on_add(size_t idx, typename status_t::storage_type bit)
+    {
+        for (auto &group : groups) {
+            if ((group.signature & bit) != 0 && group.positions[idx] == npos &&
+                status[idx].contains(group.signature)) {
+                group_insert(group, idx);
+            }
+        }
+    }
+
+    // called before a component bit is cleared on idx
+    inline void groups_on_remove(size_t idx, typename status_t::storage_type bit)
+    {
+        for (auto &group : groups) {
+            if ((group.signature & bit) != 0 && group.positions[idx] != npos) {
+                group_erase(group, idx);
+            }
+        }
+    }
+
+    // order of the alive entities for a sort_by pass: the ones having C by key, then the others
+    template<typename C, typename F>
+    inline void start_sort_pass(F &key_fn)
+    {
+        using key_t = std::decay_t<decltype(key_fn(std::declval<const C &>()))>;
+        std::vector<std::pair<key_t, size_t>> keyed;
+        keyed.reserve(live_counts[component_index<C>]);
+        for (size_t idx = 0; idx < high_water_mark; idx++) {
+            if (matches<C>(idx)) {
+                keyed.emplace_back(key_fn(std::as_const(component<C>(idx))), idx);
+            }
+        }
+        std::sort(keyed.begin(), keyed.end(), [](const auto &lhs, const auto &rhs) {
+            return lhs.first < rhs.first || (!(rhs.first < lhs.first) && lhs.second < rhs.second);
+        });
+        auto &[order, rank, cursor] = sort_pass;
+        order.clear();
+        order.reserve(number_of_entities);
+        for (const auto &[_, idx] : keyed) {
+            order.push_back(idx);
+        }
+        for (size_t idx = 0; idx < high_water_mark; idx++) {
+            if (matches<Exist>(idx) && !status[idx].template isActive<C>()) {
+                order.push_back(idx);
+            }
+        }
+        rank.assign(high_water_mark, npos);
+        for (size_t i = 0; i < order.size(); i++) {
+            rank[order[i]] = i;
+        }
+        cursor = 0;
+    }
+
+    // swaps everything stored for two slots (alive or not), the entities trade their ids
+    inline void swap_entities(size_t a, size_t b)
+    {
+        using std::swap;
+        (swap(table<Components>()[a], table<Components>()[b]), ...);
+        (
+            [&]() {
+                if constexpr (buffered_v<Components>) {
+                    swap(previous_table<Components>()[a], previous_table<Components>()[b]);
+                }
+            }(),
+            ...
+        );
+        swap(status[a], status[b]);
+        for (auto &column : columns) {
+            uint64_t bit_a = (column[a / 64] >> (a % 64)) & 1;
+            uint64_t bit_b = (column[b / 64] >> (b % 64)) & 1;
+            if (bit_a != bit_b) {
+                column[a / 64] ^= uint64_t {1} << (a % 64);
+                column[b / 64] ^= uint64_t {1} << (b % 64);
+            }
+        }
+        for (auto &group : groups) {
+            if (group.positions[a] != npos) {
+                group.entities[group.positions[a]] = b;
+            }
+            if (group.positions[b] != npos) {
+                group.entities[group.positions[b]] = a;
+            }
+            swap(group.positions[a], group.positions[b]);
+        }
+    }
+
+    // identifies the table layout, a persistent world saved with other components is not reopened
+    static auto layout() -> uint64_t
+    {
+        fnv::Hasher hash;
+        auto mix = [&hash](std::string_view name, size_t size) {
+            hash.mix(name);
+            hash.mix_value(size);
+        };
+        mix("status", sizeof(status_t));
+        (mix(dbg::type_name<Components>(), sizeof(Components)), ...);
+        return hash.value();
+    }
+
+    inline void save_metadata()
+    {
+        if constexpr (Storage::persistent) {
+            if (metadata.size() == 1) {
+                metadata[0] = Metadata {layout(), tables_capacity, number_of_entities, high_water_mark};
+            }
+        }
+    }
+
+    // picks up the tables left by a previous world of a persistent storage, false when starting empty
+    // tables saved by a world with other components are never touched: opening them aborts
+    inline auto restore() -> bool
+    {
+        if constexpr (Storage::persistent) {
+            // a capacity of 0: the storage is new or its world never saved its counters
+            if (metadata.size() == 1 && metadata[0].capacity != 0) {
+                const Metadata saved = metadata[0];
+                if (saved.layout != layout()) {
+                    std::cerr << "World: the saved world has other components, its tables are left as is\n";
+                    std::abort();
+                }
+                bool complete = status.size() >= saved.capacity &&
+                                ((table<Components>().size() >= saved.capacity) && ...);
+                if (!complete) {
+                    std::cerr << "World: saved tables shorter than their capacity " << saved.capacity << "\n";
+                    std::abort();
+                }
+                tables_capacity = saved.capacity;
+                number_of_entities = saved.entities;
+                high_water_mark = saved.high_water_mark;
+                for (auto &column : columns) {
+                    column.resize((tables_capacity + 63) / 64, 0);
+                }
+                for (size_t idx = 0; idx < high_water_mark; idx++) {
+                    columns_sync(idx);
+                }
+                // the previous values are not saved, they restart from the current ones
+                (
+                    [&]() {
+                        if constexpr (buffered_v<Components>) {
+                            previous_table<Components>().resize(tables_capacity);
+                        }
+                    }(),
+                    ...
+                );
+                store_previous();
+                return true;
+            }
+            metadata.resize(1);
+            status.resize(0);
+            (table<Components>().resize(0), ...);
+        }
+        return false;
+    }
+
+    // fixed tables are built in place, passed to the tuple they would all be temporaries on the stack
+    static auto make_tables(const Storage &storage) -> tables_t
+    {
+        if constexpr (fixed_capacity) {
+            return tables_t {};
+        } else {
+            return tables_t(storage.template make_table<slot_t<Components>>(
+                dbg::type_name<Components>(), placement_v<Components>
+            )...);
+        }
+    }
+
+    static auto make_previous_tables(const Storage &storage) -> previous_tables_t
+    {
+        if constexpr (fixed_capacity) {
+            return previous_tables_t {};
+        } else {
+            return previous_tables_t([&storage]() -> previous_table_t<Components> {
+                if constexpr (buffered_v<Components>) {
+                    return storage.template make_table<slot_t<Components>>(
+                        std::string(dbg::type_name<Components>()) + ".previous", placement_v<Components>
+                    );
+                } else {
+                    return {};
+                }
+            }()...);
+        }
+    }
+
+    static auto make_metadata(const Storage &storage) -> decltype(metadata)
+    {
+        if constexpr (Storage::persistent) {
+            return storage.template make_table<Metadata>("world");
+        } else {
+            return {};
+        }
     }
 
 public:
-    World()
+    // entity that changed id after a sort
+    struct Remap {
+        size_t from;
+        size_t to;
+    };
+
+    explicit BasicWorld(const Storage &storage = {}):
+        status(storage.template make_table<status_t>("status")),
+        tables(make_tables(storage)),
+        previous_tables(make_previous_tables(storage)),
+        metadata(make_metadata(storage))
+    {
+        if (!restore()) {
+            increase_capacity(fixed_capacity ? max_capacity : defaultTableCapacity);
+        }
+        if constexpr (fixed_capacity) {
+            // the profiled counters of the building thread then never allocate
+            PROFILE_THREAD();
+        }
+    }
+
+    BasicWorld(const BasicWorld &) = default;
+    BasicWorld(BasicWorld &&) noexcept = default;
+    auto operator=(const BasicWorld &) -> BasicWorld & = default;
+    auto operator=(BasicWorld &&) noexcept -> BasicWorld & = default;
+
+    ~BasicWorld()
+    {
+        save_metadata();
+    }
+
+    // persistent storages: writes the counters and every table back to the storage
+    inline void flush()
     {
-        increase_capacity(defaultTableCapacity);
+        if constexpr (Storage::persistent) {
+            PROFILE_ZONE("World::flush");
+            save_metadata();
+            status.flush();
+            (table<Components>().flush(), ...);
+            metadata.flush();
+        }
     }
 
     // template<typename C>
@@ -54,94 +705,756 @@ public:
     // inline auto get(size_t idx) -> std::optional<C>
     // {
     //     if (status[idx].template isActive<C>()) {
-    //         return std::optional<C>(std::get<container_t<C>>(tables)[idx]);
+    //         return std::optional<C>(std::get<table_t<C>>(tables)[idx]);
     //     }
     //     return std::nullopt;
     // }
     template<typename... Cs>
-        requires are_types_unique_v<Cs...> && (World::are_from_components_v<Cs> && ...)
+        requires are_types_unique_v<Cs...> && (BasicWorld::are_from_components_v<Cs> && ...)
     inline auto get(size_t idx) -> std::optional<std::tuple<Cs &...>>
     {
         if ((status[idx].template isActive<Cs>() && ...)) {
-            return std::make_optional(std::tie(std::get<container_t<Cs>>(tables)[idx]...));
+            (count_reads<Cs>(1), ...);
+            return std::make_optional(std::tie(component<Cs>(idx)...));
         }
         return std::nullopt;
     }
 
+    // the values of buffered components at the last store_previous(), i.e. at the end of the previous tick
+    // A system reading them never sees the writes of the current tick, whatever the order systems run in.
+    // Component writes never touch these tables, structural changes (add, remove, sort_by) still do.
+    template<typename... Cs>
+        requires are_types_unique_v<Cs...> && (BasicWorld::are_from_components_v<Cs> && ...) &&
+                 (buffered_v<Cs> && ...)
+    inline auto previous(size_t idx) const -> std::optional<std::tuple<const Cs &...>>
+    {
+        if ((status[idx].template isActive<Cs>() && ...)) {
+            return std::make_optional(std::tie(previous_component<Cs>(idx)...));
+        }
+        return std::nullopt;
+    }
+
+    // tick boundary: the current values of the buffered components become the previous ones
+    // A copy of the used rows rather than a swap of the tables, rows no system wrote during the tick
+    // have to keep their value.
+    inline void store_previous()
+    {
+        PROFILE_ZONE("World::store_previous");
+        (
+            [&]() {
+                if constexpr (buffered_v<Components>) {
+                    const auto &current = table<Components>();
+                    auto &previous = previous_table<Components>();
+                    std::copy(current.begin(), current.begin() + high_water_mark, previous.begin());
+                }
+            }(),
+            ...
+        );
+    }
+
     // template<typename... Cs>
     //     requires are_types_unique_v<Cs...> && (World::are_from_components_v<Cs> && ...)
     // inline auto set(size_t idx, Cs &&...components) -> void
     // {
-    //     ((std::get<container_t<Cs>>(tables)[idx] = std::forward<Cs>(components)), ...);
+    //     ((std::get<table_t<Cs>>(tables)[idx] = std::forward<Cs>(components)), ...);
     // }
 
+    // hints the cache to load what get<Cs...>(idx) reads, meant to be issued a few lookups ahead
+    template<typename... Cs>
+        requires(BasicWorld::are_from_components_v<Cs> && ...)
+    inline void prefetch([[maybe_unused]] size_t idx) const
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(&status[idx]);
+        (__builtin_prefetch(&table<Cs>()[idx]), ...);
+#endif
+    }
+
+    // Gathers the Cs of scattered entities (e.g. ids stored in components or events): out[i] points at the
+    // components of entities[i], or holds nullptrs when it lacks one of them. The rows of the entity
+    // distance positions ahead are prefetched, so the cache misses of consecutive lookups overlap.
+    // The rows are only cached until the batch outgrows the cache, large batches are faster with each_many.
+    template<typename... Cs>
+        requires are_types_unique_v<Cs...> && (BasicWorld::are_from_components_v<Cs> && ...)
+    inline void get_many(
+        std::span<const Entity> entities, std::span<std::tuple<Cs *...>> out,
+        size_t distance = defaultPrefetchDistance
+    )
+    {
+        size_t count = std::min(entities.size(), out.size());
+        for (size_t i = 0; i < std::min(distance, count); i++) {
+            prefetch<Cs...>(entities[i]);
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (i + distance < count) {
+                prefetch<Cs...>(entities[i + distance]);
+            }
+            size_t idx = entities[i];
+            if ((status[idx].template isActive<Cs>() && ...)) {
+                (count_reads<Cs>(1), ...);
+                out[i] = std::tuple<Cs *...>(&component<Cs>(idx)...);
+            } else {
+                out[i] = {};
+            }
+        }
+    }
+
+    template<typename... Cs>
+        requires are_types_unique_v<Cs...> && (BasicWorld::are_from_components_v<Cs> && ...)
+    [[nodiscard]] inline auto get_many(
+        std::span<const Entity> entities, size_t distance = defaultPrefetchDistance
+    ) -> std::vector<std::tuple<Cs *...>>
+    {
+        std::vector<std::tuple<Cs *...>> out(entities.size());
+        get_many<Cs...>(entities, std::span<std::tuple<Cs *...>>(out), distance);
+        return out;
+    }
+
+    // calls fn(entity, Cs &...) for the entities having all of Cs, in order, prefetching distance ahead
+    // the work of fn overlaps the cache misses of the next lookups
+    template<typename... Cs, typename F>
+        requires are_types_unique_v<Cs...> && (BasicWorld::are_from_components_v<Cs> && ...)
+    inline void each_many(std::span<const Entity> entities, F &&fn, size_t distance = defaultPrefetchDistance)
+    {
+        size_t count = entities.size();
+        for (size_t i = 0; i < std::min(distance, count); i++) {
+            prefetch<Cs...>(entities[i]);
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (i + distance < count) {
+                prefetch<Cs...>(entities[i + distance]);
+            }
+            size_t idx = entities[i];
+            if ((status[idx].template isActive<Cs>() && ...)) {
+                (count_reads<Cs>(1), ...);
+                fn(idx, component<Cs>(idx)...);
+            }
+        }
+    }
+
     template<typename... Cs>
-        requires are_types_unique_v<Cs...> && (World::are_from_components_v<Cs> && ...)
+        requires are_types_unique_v<Cs...> && (BasicWorld::are_from_components_v<Cs> && ...)
     inline auto has(size_t idx) -> bool
     {
         return (status[idx].template isActive<Cs>() && ...);
     }
 
+    // true when idx has no component outside Cs, e.g. before saving an entity with only some components
+    template<typename... Cs>
+        requires are_types_unique_v<Cs...> && (BasicWorld::are_from_components_v<Cs> && ...)
+    inline auto has_only(size_t idx) const -> bool
+    {
+        return status[idx].containsOnly(status_t::template mask<Exist, Cs...>);
+    }
+
     template<typename C>
         requires are_from_components_v<C>
     inline auto add(size_t idx, C &&component) -> void
     {
-        std::get<container_t<C>>(tables)[idx] = std::forward<C>(component);
-        status[idx].template activate<C>();
+        table<C>()[idx] = std::forward<C>(component);
+        on_added<C>(idx);
+    }
+
+    // constructs C from args directly in the table, without a temporary to move from
+    template<typename C, typename... Args>
+        requires are_from_components_v<C> && std::is_constructible_v<C, Args...>
+    inline auto emplace(size_t idx, Args &&...args) -> C &
+    {
+        auto &slot = table<C>()[idx];
+        if constexpr (!std::is_default_constructible_v<C>) {
+            slot.emplace(std::forward<Args>(args)...);
+        } else if constexpr (std::is_nothrow_constructible_v<C, Args...>) {
+            // the slot always holds a C, it is rebuilt in place
+            std::destroy_at(&slot);
+            std::construct_at(&slot, std::forward<Args>(args)...);
+        } else {
+            slot = C(std::forward<Args>(args)...);
+        }
+        on_added<C>(idx);
+        return component<C>(idx);
+    }
+
+    // adds components[i] to entities[i], runs of consecutive ids are copied with a single memcpy when C
+    // is trivially copyable
+    template<typename C>
+        requires are_from_components_v<C>
+    inline void add_bulk(std::span<const Entity> entities, std::span<const C> components)
+    {
+        PROFILE_ZONE("World::add_bulk");
+        constexpr bool memcpy_runs = std::is_trivially_copyable_v<C> && std::is_default_constructible_v<C>;
+        constexpr size_t c = component_index<C>;
+        size_t count = std::min(entities.size(), components.size());
+        auto &slots = table<C>();
+        // same bookkeeping as on_added, with the column word and the count kept in registers
+        size_t added = 0;
+        size_t word = npos;
+        uint64_t bits = 0;
+        size_t run = 0;
+        const bool observed = (observers.adding & status_t::template mask<C>) != 0;
+        if (observed) {
+            observers.batch.clear();
+        }
+        for (size_t i = 0; i < count; i++) {
+            size_t idx = entities[i];
+            if constexpr (memcpy_runs) {
+                if (i + 1 == count || entities[i + 1] != idx + 1) {
+                    size_t bytes = (i + 1 - run) * sizeof(C);
+                    std::memcpy(static_cast<void *>(&slots[entities[run]]), &components[run], bytes);
+                    run = i + 1;
+                }
+            } else {
+                slots[idx] = components[i];
+            }
+            if (status[idx].template isActive<C>()) {
+                continue;
+            }
+            status[idx].template activate<C>();
+            if constexpr (buffered_v<C>) {
+                previous_table<C>()[idx] = components[i];
+            }
+            added++;
+            if (observed) {
+                observers.batch.push_back(idx);
+            }
+            if (idx / 64 != word) {
+                if (word != npos) {
+                    columns[c][word] |= bits;
+                }
+                word = idx / 64;
+                bits = 0;
+            }
+            bits |= uint64_t {1} << (idx % 64);
+        }
+        if (word != npos) {
+            columns[c][word] |= bits;
+        }
+        live_counts[c] += added;
+        count_writes<C>(count);
+        if (!groups.empty()) {
+            for (size_t i = 0; i < count; i++) {
+                groups_on_add(entities[i], status_t::template mask<C>);
+            }
+        }
+        if (observed) {
+            notify(observers.added[c], observers.batch);
+        }
     }
 
     template<typename C>
         requires are_from_components_v<C>
     inline auto remove(size_t idx) -> void
     {
-        status[idx].template deactivate<C>();
+        bool active = status[idx].template isActive<C>();
+        if (active && (observers.removing & status_t::template mask<C>) != 0) [[unlikely]] {
+            notify(observers.removed[component_index<C>], idx);
+        }
+        groups_on_remove(idx, status_t::template mask<C>);
+        if (active) {
+            status[idx].template deactivate<C>();
+            column_clear<C>(idx);
+            release<C>(idx);
+            count_writes<C>(1);
+        }
     }
 
 private:
+    template<typename... Cs>
+    [[nodiscard]] inline auto matches(size_t idx) const -> bool
+    {
+        return status[idx].template isActive<Exist>() && (status[idx].template isActive<Cs>() && ...);
+    }
+
     // returns the first NonExisting entity index or the tables_capacity if there are no more entities
     inline auto get_next_entity_id() -> size_t
     {
-        size_t i = 0;
-        if (number_of_entities == tables_capacity) {
-            return tables_capacity;
-        }
-        for (size_t i = 0; i < tables_capacity && i <= number_of_entities; i++) {
-            if (!status[i].template isActive<Exist>()) {
-                return i;
-            }
+        size_t i = first_free;
+        while (i < tables_capacity && status[i].template isActive<Exist>()) {
+            i++;
         }
         return i;
     }
 
 public:
+    // a full fixed capacity world aborts, use try_new_entity() where spawns may fail
     inline auto new_entity() -> size_t
     {
+        PROFILE_ZONE("World::new_entity");
         size_t idx = get_next_entity_id();
+        if constexpr (fixed_capacity) {
+            if (idx == tables_capacity) {
+                std::cerr << "World: new_entity() on a full world of " << max_capacity << " entities\n";
+                std::abort();
+            }
+        }
         number_of_entities++;
         if (idx == tables_capacity) {
             increase_capacity(tables_capacity * 2);
-            idx = number_of_entities;
         }
         status[idx].template activate<Exist>();
         (status[idx].template deactivate<Components>(), ...);
+        high_water_mark = std::max(high_water_mark, idx + 1);
+        first_free = idx + 1;
         return idx;
     }
 
+    // nullopt when a fixed capacity world is full, worlds that grow always have room
+    inline auto try_new_entity() -> std::optional<Entity>
+    {
+        if constexpr (fixed_capacity) {
+            if (number_of_entities == tables_capacity) {
+                return std::nullopt;
+            }
+        }
+        return new_entity();
+    }
+
     inline void delete_entity(size_t idx)
     {
+        PROFILE_ZONE("World::delete_entity");
+        notify_delete(idx);
         number_of_entities--;
-        status[idx].template deactivate<Exist>();
+        groups_on_remove(idx, status_t::template mask<Components...>);
+        (
+            [&]() {
+                if (status[idx].template isActive<Components>()) {
+                    column_clear<Components>(idx);
+                    release<Components>(idx);
+                }
+            }(),
+            ...
+        );
+        // drop the component bits too, so views never pick up a dead entity
+        status[idx] = {};
+        first_free = std::min(first_free, idx);
+    }
+
+    [[nodiscard]] inline auto alive(size_t idx) const -> bool
+    {
+        return idx < high_water_mark && status[idx].template isActive<Exist>();
+    }
+
+    // grows the tables so that ids below new_capacity never need a reallocation
+    // no-op for fixed capacity worlds, all their room exists from the start
+    inline void reserve(size_t new_capacity)
+    {
+        if (!fixed_capacity && new_capacity > tables_capacity) {
+            increase_capacity(std::bit_ceil(new_capacity));
+        }
+    }
+
+    // Concurrent entity creation, see concurrent()
+    // Ids come from a range reserved past the high-water mark, each Worker takes them from the shared
+    // cursor by blocks so threads only meet on one atomic every block_size entities.
+    // Workers write the components and status of their own entities (or of distinct existing ones)
+    // without locking, the counters and the groups are only updated by commit().
+    class ConcurrentScope {
+    private:
+        BasicWorld &world;
+        size_t first;
+        size_t last;
+        size_t block_size;
+        std::atomic<size_t> cursor;
+        // an existing entity given a component it did not have by a worker
+        struct Touch {
+            size_t idx;
+            size_t component;
+        };
+        // their groups and observers are updated by commit()
+        std::mutex touched_mutex;
+        container_t<Touch> touched;
+        bool committed = false;
+
+    public:
+        ConcurrentScope(BasicWorld &world, size_t count, size_t block_size):
+            world(world),
+            first(world.high_water_mark),
+            // a fixed capacity world only hands out the slots it has
+            last(
+                fixed_capacity ? std::min(world.high_water_mark + count, world.tables_capacity)
+                               : world.high_water_mark + count
+            ),
+            block_size(std::max<size_t>(block_size, 1)),
+            cursor(world.high_water_mark)
+        {
+            world.reserve(last);
+        }
+
+        ConcurrentScope(const ConcurrentScope &) = delete;
+        auto operator=(const ConcurrentScope &) -> ConcurrentScope & = delete;
+
+        ~ConcurrentScope()
+        {
+            commit();
+        }
+
+        // one per thread, to be destroyed before commit()
+        class Worker {
+        private:
+            ConcurrentScope &scope;
+            size_t next = 0;
+            size_t end = 0;
+            container_t<Touch> touched;
+
+        public:
+            explicit Worker(ConcurrentScope &scope):
+                scope(scope)
+            {
+            }
+
+            Worker(const Worker &) = delete;
+            auto operator=(const Worker &) -> Worker & = delete;
+
+            ~Worker()
+            {
+                if (!touched.empty()) {
+                    std::lock_guard lock(scope.touched_mutex);
+                    scope.touched.insert(scope.touched.end(), touched.begin(), touched.end());
+                }
+            }
+
+            // nullopt once the reserved range is used up
+            inline auto new_entity() -> std::optional<size_t>
+            {
+                if (next == end) {
+                    size_t begin = scope.cursor.fetch_add(scope.block_size, std::memory_order_relaxed);
+                    if (begin >= scope.last) {
+                        return std::nullopt;
+                    }
+                    next = begin;
+                    end = std::min(begin + scope.block_size, scope.last);
+                }
+                size_t idx = next++;
+                scope.world.status[idx] = {};
+                scope.world.status[idx].template activate<Exist>();
+                return idx;
+            }
+
+            // no two threads may add to the same entity
+            template<typename C>
+                requires are_from_components_v<C>
+            inline void add(size_t idx, C &&component)
+            {
+                scope.world.template table<C>()[idx] = std::forward<C>(component);
+                if (!scope.world.status[idx].template isActive<C>()) {
+                    scope.world.template init_previous<C>(idx);
+                    if (idx < scope.first) {
+                        touched.push_back({idx, component_index<C>});
+                    }
+                }
+                scope.world.status[idx].template activate<C>();
+            }
+        };
+
+        [[nodiscard]] inline auto worker() -> Worker { return Worker(*this); }
+
+        // makes the created entities visible: counts them, moves the high-water mark and fills the groups
+        // ids a worker reserved but did not use are left as holes for new_entity()
+        inline void commit()
+        {
+            if (committed) {
+                return;
+            }
+            committed = true;
+            PROFILE_ZONE("World::ConcurrentScope::commit");
+            size_t end = std::min(cursor.load(std::memory_order_acquire), last);
+            for (size_t idx = first; idx < end; idx++) {
+                if (world.status[idx].template isActive<Exist>()) {
+                    world.number_of_entities++;
+                    world.high_water_mark = idx + 1;
+                    world.columns_sync(idx);
+                    world.groups_on_add(idx, status_t::template mask<Components...>);
+                }
+            }
+            for (const auto &touch : touched) {
+                world.columns_sync(touch.idx);
+                world.groups_on_add(touch.idx, status_t::template mask<Components...>);
+            }
+            // one batch per component: the created entities having it, then the existing ones given it
+            (
+                [&]() {
+                    const auto &added = world.observers.added[component_index<Components>];
+                    if (added.empty()) {
+                        return;
+                    }
+                    world.template collect_batch<Components>(first, end);
+                    for (const auto &touch : touched) {
+                        if (touch.component == component_index<Components>) {
+                            world.observers.batch.push_back(touch.idx);
+                        }
+                    }
+                    notify(added, world.observers.batch);
+                }(),
+                ...
+            );
+        }
+    };
+
+    // Room for count entities created from several threads, e.g.
+    //   auto scope = world.concurrent(n);
+    //   // on each thread:
+    //   auto worker = scope.worker();
+    //   while (auto idx = worker.new_entity()) { worker.add<CPosition>(*idx, ...); }
+    //   // then, once every worker is gone:
+    //   scope.commit();
+    // Until the commit only the workers may write to the world, other threads can still read the
+    // entities that existed before, which the workers never move.
+    [[nodiscard]] inline auto concurrent(size_t count, size_t block_size = 64) -> ConcurrentScope
+    {
+        return ConcurrentScope(*this, count, block_size);
+    }
+
+    // Reorders entities so that the ones having C are laid out by ascending key_fn(const C &), followed by
+    // the alive entities without C, holes end up after every alive entity.
+    // Every table, the status and the groups are permuted together, ids held elsewhere must be patched
+    // with the returned remap. A pass sorts the keys once, then places at most max_swaps slots per call
+    // so its work is spread over several frames: each call resumes where the previous one stopped and
+    // the keys are only sorted again once the pass reached the last slot (n / max_swaps calls later).
+    // Entities created during a pass are placed by the next one, keep the same C and key_fn across calls.
+    // e.g. world.sort_by<CPosition>(spatial::MortonKey {32.0f}, 256);
+    template<typename C, typename F>
+        requires are_from_components_v<C>
+    inline auto sort_by(F &&key_fn, size_t max_swaps = npos) -> std::vector<Remap>
+    {
+        PROFILE_ZONE("World::sort_by");
+        if (max_swaps == npos || sort_pass.cursor >= sort_pass.order.size()) {
+            start_sort_pass<C>(key_fn);
+        }
+        auto &[order, rank, cursor] = sort_pass;
+
+        // origin[id]: id the entity now at id had when the call started, for the entities moved by it
+        std::unordered_map<size_t, size_t> origin;
+        auto origin_of = [&origin](size_t idx) {
+            auto found = origin.find(idx);
+            return found != origin.end() ? found->second : idx;
+        };
+        size_t end = max_swaps == npos ? order.size() : std::min(order.size(), cursor + max_swaps);
+        for (; cursor < end; cursor++) {
+            size_t slot = cursor;
+            size_t wanted = order[slot];
+            // deleted since the pass started, its slot is left to whatever holds it
+            if (wanted == slot || !status[wanted].template isActive<Exist>()) {
+                continue;
+            }
+            swap_entities(slot, wanted);
+            size_t moved_in = origin_of(wanted);
+            size_t moved_out = origin_of(slot);
+            origin[slot] = moved_in;
+            origin[wanted] = moved_out;
+            // the entity displaced from slot now waits at wanted
+            if (size_t displaced = rank[slot]; displaced != npos) {
+                order[displaced] = wanted;
+                rank[wanted] = displaced;
+            } else {
+                rank[wanted] = npos;
+            }
+            order[slot] = slot;
+            rank[slot] = slot;
+        }
+
+        while (high_water_mark > 0 && !status[high_water_mark - 1].template isActive<Exist>()) {
+            high_water_mark--;
+        }
+        first_free = 0;
+
+        std::vector<Remap> remap;
+        for (const auto &[idx, from] : origin) {
+            if (idx != from && status[idx].template isActive<Exist>()) {
+                remap.push_back({from, idx});
+            }
+        }
+        std::sort(remap.begin(), remap.end(), [](const Remap &lhs, const Remap &rhs) {
+            return lhs.from < rhs.from;
+        });
+        return remap;
+    }
+
+    // fn(entities) runs after C was added to them by add, emplace, add_bulk or a concurrent commit,
+    // replacing the C of an entity is not an add
+    // observers must not change the structure of the world nor register or remove observers
+    template<typename C>
+        requires are_from_components_v<C>
+    inline auto on_add(Observer fn) -> ObserverId
+    {
+        observers.added[component_index<C>].push_back({observers.next_id, std::move(fn)});
+        observers.adding |= status_t::template mask<C>;
+        return observers.next_id++;
+    }
+
+    // fn(entities) runs before they lose C, through remove, delete_entity or clear
+    template<typename C>
+        requires are_from_components_v<C>
+    inline auto on_remove(Observer fn) -> ObserverId
+    {
+        observers.removed[component_index<C>].push_back({observers.next_id, std::move(fn)});
+        observers.removing |= status_t::template mask<C>;
+        return observers.next_id++;
+    }
+
+    // fn(entities) runs before they are deleted (or cleared), after the on_remove observers
+    inline auto on_delete(Observer fn) -> ObserverId
+    {
+        observers.deleted.push_back({observers.next_id, std::move(fn)});
+        return observers.next_id++;
+    }
+
+    inline void unobserve(ObserverId id)
+    {
+        auto drop = [id](container_t<ObserverSlot> &slots) {
+            std::erase_if(slots, [id](const ObserverSlot &slot) { return slot.id == id; });
+        };
+        (
+            [&]() {
+                drop(observers.added[component_index<Components>]);
+                drop(observers.removed[component_index<Components>]);
+                if (observers.added[component_index<Components>].empty()) {
+                    observers.adding &= ~status_t::template mask<Components>;
+                }
+                if (observers.removed[component_index<Components>].empty()) {
+                    observers.removing &= ~status_t::template mask<Components>;
+                }
+            }(),
+            ...
+        );
+        drop(observers.deleted);
+    }
+
+    // appends event to the channel of E, read back by events<E>() until the next clear_events()
+    template<typename E>
+    inline void emit(E event)
+    {
+        channels.channel<E>().emit(std::move(event));
+    }
+
+    // buffers the events of one thread, they reach events<E>() when it is flushed or destroyed
+    template<typename E>
+    [[nodiscard]] inline auto event_writer() -> typename EventChannel<E>::Writer
+    {
+        return typename EventChannel<E>::Writer(channels.channel<E>());
+    }
+
+    // the events of type E emitted since the last clear_events(), packed in emission order
+    template<typename E>
+    [[nodiscard]] inline auto events() const -> std::span<const E>
+    {
+        const auto *channel = channels.find<E>();
+        return channel != nullptr ? channel->read() : std::span<const E> {};
+    }
+
+    // frame boundary, drops the events of every type
+    inline void clear_events() { channels.clear(); }
+
+    // to be called once per tick: profiled builds report the reads and writes of every component during
+    // the tick as counters and add them to the per tick averages of stats()
+    inline void report_access()
+    {
+#ifdef BECS_PROFILE
+        (
+            [this]() {
+                constexpr size_t i = component_index<Components>;
+                constexpr const char *reads = dbg::type_list_label<"reads", Components>.data();
+                constexpr const char *writes = dbg::type_list_label<"writes", Components>.data();
+                PROFILE_COUNTER(reads, tick_access[i].reads);
+                PROFILE_COUNTER(writes, tick_access[i].writes);
+                total_access[i].reads += tick_access[i].reads;
+                total_access[i].writes += tick_access[i].writes;
+                tick_access[i] = {};
+            }(),
+            ...
+        );
+        access_ticks++;
+#endif
     }
 
     [[nodiscard]] inline auto size() const -> size_t { return number_of_entities; }
 
+    // reads the counters the world keeps, meant for diagnostics and not for every frame
+    [[nodiscard]] auto stats() const -> WorldStats
+    {
+        WorldStats result {};
+        result.capacity = tables_capacity;
+        result.live_entities = number_of_entities;
+        result.dead_slots = tables_capacity - number_of_entities;
+        result.high_water_mark = high_water_mark;
+        result.holes = high_water_mark - number_of_entities;
+        result.growth_events = growth_events;
+        result.growth_bytes_copied = growth_bytes_copied;
+        result.status_bytes = status.capacity() * sizeof(status_t);
+        for (const auto &group : groups) {
+            result.index_bytes += group.entities.capacity() * sizeof(size_t);
+            result.index_bytes += group.positions.capacity() * sizeof(size_t);
+        }
+        result.index_bytes += groups.size() * sizeof(Group);
+        for (const auto &column : columns) {
+            result.index_bytes += column.capacity() * sizeof(uint64_t);
+        }
+        result.event_bytes = channels.capacity_bytes();
+        result.allocated_bytes = result.status_bytes + result.index_bytes + result.event_bytes;
+
+        size_t i = 0;
+        (
+            [&]() {
+                const auto &slots = table<Components>();
+                const size_t live = live_counts[i];
+                ComponentStats component {
+                    dbg::type_name<Components>(), sizeof(Components), live,
+                    slots.capacity() * sizeof(slot_t<Components>), live * sizeof(Components),
+                    placement_v<Components>, buffered_v<Components>};
+                if constexpr (buffered_v<Components>) {
+                    const auto &previous = previous_table<Components>();
+                    component.capacity_bytes += previous.capacity() * sizeof(slot_t<Components>);
+                }
+#ifdef BECS_PROFILE
+                if (access_ticks != 0) {
+                    auto ticks = static_cast<double>(access_ticks);
+                    component.reads_per_tick = static_cast<double>(total_access[i].reads) / ticks;
+                    component.writes_per_tick = static_cast<double>(total_access[i].writes) / ticks;
+                }
+#endif
+                result.allocated_bytes += component.capacity_bytes;
+                result.components.push_back(component);
+                i++;
+            }(),
+            ...
+        );
+        return result;
+    }
+
     [[nodiscard]] inline auto capacity() const -> size_t { return tables_capacity; }
 
+    // observers are told about every alive entity, by component then as deleted
     inline auto clear() -> void
     {
+        (
+            [&]() {
+                const auto &removed = observers.removed[component_index<Components>];
+                if (!removed.empty()) {
+                    notify(removed, collect_batch<Components>(0, high_water_mark));
+                }
+            }(),
+            ...
+        );
+        if (!observers.deleted.empty()) {
+            notify(observers.deleted, collect_batch<Exist>(0, high_water_mark));
+        }
+        if constexpr ((!std::is_default_constructible_v<Components> || ...)) {
+            for (size_t idx = 0; idx < high_water_mark; idx++) {
+                ((status[idx].template isActive<Components>() ? release<Components>(idx) : void()), ...);
+            }
+        }
         number_of_entities = 0;
-        (std::get<container_t<Components>>(tables).clear(), ...);
-        status.clear();
+        high_water_mark = 0;
+        first_free = 0;
+        sort_pass = {};
+        std::fill(status.begin(), status.end(), status_t {});
+        for (auto &group : groups) {
+            group.entities.clear();
+            std::fill(group.positions.begin(), group.positions.end(), npos);
+        }
+        live_counts = {};
+        for (auto &column : columns) {
+            std::fill(column.begin(), column.end(), 0);
+        }
+        channels.clear();
     }
 
     // begin and end iterators for the world return indices of alive entities
@@ -156,23 +1469,70 @@ public:
         using iterator_category = std::forward_iterator_tag;
 
     private:
-        const World &world;
+        const BasicWorld &world;
         size_t idx;
+        // driver column of the view, nullptr to test every slot
+        const column_t *column = nullptr;
+#ifdef BECS_PROFILE
+        size_t *visited = nullptr;
+#endif
+
+        // first slot at or after from holding a match, or the high-water mark
+        [[nodiscard]] inline auto seek(size_t from) const -> size_t
+        {
+            if (column == nullptr) {
+                while (from < world.high_water_mark && !world.template matches<Cs...>(from)) {
+                    from++;
+                }
+                return from;
+            }
+            return seek_column(from);
+        }
+
+        // kept out of seek() so that the scan loop stays small enough to be inlined
+        [[nodiscard]] auto seek_column(size_t from) const -> size_t
+        {
+            size_t limit = world.high_water_mark;
+            from = column_next(*column, from, limit);
+            while (from < limit && !world.template matches<Cs...>(from)) {
+                from = column_next(*column, from + 1, limit);
+            }
+            return from;
+        }
 
     public:
-        iterator(const World &world, size_t idx):
+        iterator(const BasicWorld &world, size_t idx):
             world(world),
             idx(idx)
         {
         }
 
-        // increment until we find an alive entity or reach the end
+        // starts on the first match at or after idx
+        iterator(const BasicWorld &world, size_t idx, const column_t *column):
+            world(world),
+            idx(idx),
+            column(column)
+        {
+            this->idx = seek(idx);
+        }
+
+#ifdef BECS_PROFILE
+        iterator(const BasicWorld &world, size_t idx, const column_t *column, size_t *visited):
+            iterator(world, idx, column)
+        {
+            this->visited = visited;
+        }
+#endif
+
+        // increment until we find an alive entity having all of Cs or reach the end
         inline auto operator++() -> iterator &
         {
-            idx++;
-            while (idx < world.number_of_entities && (!world.status[idx].template isActive<Cs>() && ...)) {
-                idx++;
+#ifdef BECS_PROFILE
+            if (visited != nullptr) {
+                ++*visited;
             }
+#endif
+            idx = seek(idx + 1);
             return *this;
         }
 
@@ -193,50 +1553,183 @@ public:
     inline auto begin() const -> iterator<Exist>
     {
         size_t idx = 0;
-        while (idx < number_of_entities && !status[idx].template isActive<Exist>()) {
+        while (idx < high_water_mark && !status[idx].template isActive<Exist>()) {
             idx++;
         }
         return iterator<Exist>(*this, idx);
     }
 
-    inline auto end() const -> iterator<Exist> { return iterator<Exist>(*this, number_of_entities); }
+    inline auto end() const -> iterator<Exist> { return iterator<Exist>(*this, high_water_mark); }
 
     template<typename... FilterComponents>
         requires are_types_unique_v<FilterComponents...>
     class View {
     public:
-        using iterator = typename World::template iterator<FilterComponents...>;
+        using iterator = typename BasicWorld::template iterator<FilterComponents...>;
 
     private:
-        const World &world;
+        const BasicWorld &world;
+#ifdef BECS_PROFILE
+        // entities yielded through this view, reported as a counter when it goes out of scope
+        mutable size_t visited = 0;
+#endif
 
     public:
-        View(const World &world):
+        View(const BasicWorld &world):
             world(world)
         {
         }
-        [[nodiscard]] inline auto begin() const -> iterator
+
+#ifdef BECS_PROFILE
+        View(const View &other):
+            world(other.world)
         {
-            size_t idx = 0;
-            while (idx < world.number_of_entities && !world.status[idx].template isActive<World::Exist>() ||
-                   (!world.status[idx].template isActive<FilterComponents>() || ...)) {
-                idx++;
+        }
+
+        ~View()
+        {
+            constexpr const char *name = dbg::type_list_label<"view", FilterComponents...>.data();
+            if (visited != 0) {
+                PROFILE_COUNTER(name, visited);
             }
-            return iterator(world, 0);
+        }
+#endif
+
+        // the plan is picked here, from the live counts at the time the iteration starts
+        [[nodiscard]] inline auto begin() const -> iterator
+        {
+            const column_t *column = world.template driver_column<FilterComponents...>();
+#ifdef BECS_PROFILE
+            return iterator(world, 0, column, &visited);
+#else
+            return iterator(world, 0, column);
+#endif
         }
 
-        [[nodiscard]] inline auto end() const -> iterator
+        [[nodiscard]] inline auto plan() const -> QueryPlan
         {
-            return iterator(world, world.number_of_entities);
+            return world.template plan<FilterComponents...>();
         }
+
+        [[nodiscard]] inline auto end() const -> iterator { return iterator(world, world.high_water_mark); }
     };
 
     template<typename... Cs>
-        requires are_types_unique_v<Cs...> && (World::are_from_components_v<Cs> && ...)
+        requires are_types_unique_v<Cs...> && (BasicWorld::are_from_components_v<Cs> && ...)
     [[nodiscard]] inline auto view() const -> View<Cs...>
     {
         return View<Cs...>(*this);
     }
+
+private:
+    // index among Cs of the component with the fewest live entities
+    template<typename... Cs>
+    [[nodiscard]] inline auto most_selective() const -> size_t
+    {
+        size_t best = npos;
+        (
+            [&]() {
+                if (best == npos || live_counts[component_index<Cs>] < live_counts[best]) {
+                    best = component_index<Cs>;
+                }
+            }(),
+            ...
+        );
+        return best;
+    }
+
+    // column driving a view of Cs, nullptr when scanning is as cheap
+    template<typename... Cs>
+    [[nodiscard]] inline auto driver_column() const -> const column_t *
+    {
+        size_t best = most_selective<Cs...>();
+        return live_counts[best] * columnSelectivity <= high_water_mark ? &columns[best] : nullptr;
+    }
+
+public:
+    // how view<Cs...>() would iterate right now, for debugging
+    template<typename... Cs>
+        requires are_types_unique_v<Cs...> && (BasicWorld::are_from_components_v<Cs> && ...)
+    [[nodiscard]] inline auto plan() const -> QueryPlan
+    {
+        static constexpr std::array<std::string_view, number_of_components> names = {
+            dbg::type_name<Components>()...};
+        size_t best = most_selective<Cs...>();
+        auto kind = driver_column<Cs...>() == nullptr ? QueryPlan::Kind::Scan : QueryPlan::Kind::Column;
+        return QueryPlan {kind, names[best], live_counts[best], high_water_mark};
+    }
+
+    // number of alive entities having C
+    template<typename C>
+        requires are_from_components_v<C>
+    [[nodiscard]] inline auto count() const -> size_t
+    {
+        return live_counts[component_index<C>];
+    }
+    // Packed set of the entities having all of Cs, iterating it never visits a non matching entity
+    template<typename... Cs>
+        requires are_types_unique_v<Cs...>
+    class GroupView {
+    public:
+        using iterator = typename container_t<size_t>::const_iterator;
+
+    private:
+        BasicWorld &world;
+        const container_t<size_t> &entities;
+
+    public:
+        GroupView(BasicWorld &world, const container_t<size_t> &entities):
+            world(world),
+            entities(entities)
+        {
+        }
+
+        [[nodiscard]] inline auto begin() const -> iterator { return entities.begin(); }
+        [[nodiscard]] inline auto end() const -> iterator { return entities.end(); }
+        [[nodiscard]] inline auto size() const -> size_t { return entities.size(); }
+
+        // calls fn(entity, Cs &...) for every member, members must not gain or lose Cs meanwhile
+        template<typename F>
+        inline void each(F &&fn) const
+        {
+#ifdef BECS_PROFILE
+            constexpr const char *name = dbg::type_list_label<"group", Cs...>.data();
+            PROFILE_COUNTER(name, entities.size());
+            (world.template count_reads<Cs>(entities.size()), ...);
+#endif
+            for (size_t i = 0; i < entities.size(); i++) {
+                size_t idx = entities[i];
+                fn(idx, world.template component<Cs>(idx)...);
+            }
+        }
+    };
+
+    // returns the group of Cs, declaring it (and filling it from the current entities) on first use
+    // the order of Cs does not matter, group<A, B> and group<B, A> share the same storage
+    template<typename... Cs>
+        requires are_types_unique_v<Cs...> && (BasicWorld::are_from_components_v<Cs> && ...)
+    [[nodiscard]] inline auto group() -> GroupView<Cs...>
+    {
+        constexpr auto signature = status_t::template mask<Cs...>;
+        auto it = std::find_if(groups.begin(), groups.end(), [&](const Group &group) {
+            return group.signature == signature;
+        });
+        if (it == groups.end()) {
+            Group &group = groups.emplace_back(Group {signature, {}, container_t<size_t>(tables_capacity, npos)});
+            if constexpr (fixed_capacity) {
+                // members are added during the ticks, they must not allocate then
+                group.entities.reserve(tables_capacity);
+            }
+            for (size_t idx = 0; idx < high_water_mark; idx++) {
+                if (matches<Cs...>(idx)) {
+                    group_insert(group, idx);
+                }
+            }
+            return GroupView<Cs...>(*this, group.entities);
+        }
+        return GroupView<Cs...>(*this, it->entities);
+    }
+
     // template<typename... Cs>
     //     requires are_types_unique_v<Cs...> && (is_component_v<Cs> && ...)
     // inline auto begin() const -> iterator<Exist, Cs...>
@@ -257,3 +1750,6 @@ public:
     //     return iterator<Exist, Cs...>(*this, number_of_entities);
     // }
 };
+
+template<typename... Components>
+using World = BasicWorld<VectorStorage, Components...>;
@@ -0,0 +1,281 @@
+
+#pragma once
+
+#include "World.hpp"
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Holds N independent Worlds (one per match or spatial region) and steps them in parallel.
+// Entities never share state across shards, so each shard is simulated by a single thread
+// without any locking, the only synchronization point is the end of step().
+template<typename... Components>
+    requires are_types_unique_v<Components...>
+class WorldShard {
+public:
+    using world_t = World<Components...>;
+
+    struct EntityRef {
+        size_t shard;
+        size_t entity;
+
+        inline auto operator==(const EntityRef &other) const -> bool = default;
+    };
+
+    struct Migration {
+        EntityRef from;
+        EntityRef to;
+    };
+
+private:
+    struct PendingMigration {
+        size_t entity;
+        size_t to;
+    };
+
+    std::vector<world_t> shards;
+    // one queue per source shard, so a system stepping shard i can queue migrations without locking
+    std::vector<std::vector<PendingMigration>> migration_queues;
+
+    std::function<void(world_t &, size_t)> job;
+    std::atomic<size_t> next_shard = 0;
+    bool stopping = false;
+    std::barrier<> start_barrier;
+    std::barrier<> done_barrier;
+    std::vector<std::jthread> workers;
+
+private:
+    static inline auto worker_count(size_t shard_count, size_t threads) -> size_t
+    {
+        if (threads == 0) {
+            threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        }
+        // the calling thread takes part in every step
+        return std::min(threads, shard_count) - 1;
+    }
+
+    // pulls shards until all of them have been stepped
+    inline void run_job()
+    {
+        for (size_t idx = next_shard.fetch_add(1); idx < shards.size(); idx = next_shard.fetch_add(1)) {
+            job(shards[idx], idx);
+        }
+    }
+
+    inline void worker_loop()
+    {
+        while (true) {
+            start_barrier.arrive_and_wait();
+            if (stopping) {
+                return;
+            }
+            run_job();
+            done_barrier.arrive_and_wait();
+        }
+    }
+
+    // components of an entity on its way to another shard
+    struct Detached {
+        EntityRef from;
+        size_t to;
+        std::tuple<std::optional<Components>...> components;
+    };
+
+    template<typename C>
+    static inline void take_component(world_t &src, size_t src_idx, std::optional<C> &slot)
+    {
+        if (auto opt = src.template get<C>(src_idx); opt.has_value()) {
+            auto &[component] = opt.value();
+            slot.emplace(std::move(component));
+        }
+    }
+
+    template<typename C>
+    static inline void put_component(world_t &dst, size_t dst_idx, std::optional<C> &slot)
+    {
+        if (slot.has_value()) {
+            dst.template add<C>(dst_idx, std::move(slot.value()));
+        }
+    }
+
+    // drops the queued migrations of the entities deleted from a shard: their ids can be handed out again
+    // (by that shard, or by flush_migrations moving entities in) before the queue is flushed
+    inline void forget_migrations(size_t shard_idx, std::span<const size_t> entities)
+    {
+        auto &queue = migration_queues[shard_idx];
+        if (queue.empty()) {
+            return;
+        }
+        std::erase_if(queue, [entities](const PendingMigration &pending) {
+            return std::find(entities.begin(), entities.end(), pending.entity) != entities.end();
+        });
+    }
+
+public:
+    // threads == 0 uses every hardware thread, never more threads than shards are started
+    explicit WorldShard(size_t shard_count, size_t threads = 0):
+        shards(std::max<size_t>(shard_count, 1)),
+        migration_queues(shards.size()),
+        start_barrier(static_cast<std::ptrdiff_t>(worker_count(shards.size(), threads) + 1)),
+        done_barrier(static_cast<std::ptrdiff_t>(worker_count(shards.size(), threads) + 1))
+    {
+        for (size_t idx = 0; idx < shards.size(); idx++) {
+            shards[idx].on_delete([this, idx](std::span<const size_t> entities) {
+                forget_migrations(idx, entities);
+            });
+        }
+        size_t count = worker_count(shards.size(), threads);
+        workers.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            workers.emplace_back([this]() { worker_loop(); });
+        }
+    }
+
+    WorldShard(const WorldShard &) = delete;
+    WorldShard &operator=(const WorldShard &) = delete;
+
+    ~WorldShard()
+    {
+        stopping = true;
+        start_barrier.arrive_and_wait();
+    }
+
+    [[nodiscard]] inline auto shard_count() const -> size_t { return shards.size(); }
+
+    [[nodiscard]] inline auto shard(size_t idx) -> world_t & { return shards[idx]; }
+    [[nodiscard]] inline auto shard(size_t idx) const -> const world_t & { return shards[idx]; }
+
+    [[nodiscard]] inline auto size() const -> size_t
+    {
+        size_t total = 0;
+        for (const auto &world : shards) {
+            total += world.size();
+        }
+        return total;
+    }
+
+    inline auto new_entity(size_t shard_idx) -> EntityRef { return {shard_idx, shards[shard_idx].new_entity()}; }
+
+    inline void delete_entity(EntityRef ref) { shards[ref.shard].delete_entity(ref.entity); }
+
+    // runs system(world, shard_index) once for every shard, spread over the worker threads
+    // system must only touch the world it is given (and migrate() entities of that world)
+    template<typename F>
+    inline void step(F &&system)
+    {
+        job = std::forward<F>(system);
+        next_shard = 0;
+        if (workers.empty()) {
+            run_job();
+            return;
+        }
+        start_barrier.arrive_and_wait();
+        run_job();
+        done_barrier.arrive_and_wait();
+    }
+
+    // queues ref to be moved to another shard on the next flush_migrations()
+    // safe to call from inside step() as long as ref belongs to the shard being stepped
+    // deleting the entity before the flush cancels its migration
+    inline void migrate(EntityRef ref, size_t to)
+    {
+        if (to >= shards.size()) {
+            std::cerr << "WorldShard: entity " << ref.entity << " migrated to shard " << to << ", there are "
+                      << shards.size() << "\n";
+            std::abort();
+        }
+        if (ref.shard != to) {
+            migration_queues[ref.shard].push_back({ref.entity, to});
+        }
+    }
+
+    // queues a migration for every entity whose C component maps to another shard
+    // e.g. rebalance<CPosition>([](const CPosition &pos) { return region_of(pos); })
+    template<typename C, typename F>
+        requires world_t::template are_from_components_v<C>
+    inline void rebalance(F &&shard_of)
+    {
+        step([this, &shard_of](world_t &world, size_t shard_idx) {
+            for (auto entity : world.template view<C>()) {
+                if (auto opt = world.template get<C>(entity); opt.has_value()) {
+                    auto &[component] = opt.value();
+                    size_t target = static_cast<size_t>(shard_of(std::as_const(component)));
+                    if (target < shards.size()) {
+                        migrate({shard_idx, entity}, target);
+                    }
+                }
+            }
+        });
+    }
+
+    [[nodiscard]] inline auto pending_migrations() const -> size_t
+    {
+        size_t total = 0;
+        for (const auto &queue : migration_queues) {
+            total += queue.size();
+        }
+        return total;
+    }
+
+    // moves every queued entity with all its components, to be called between steps
+    // returns the old -> new reference of each moved entity so external references can be patched
+    // every source entity is deleted before the first one is created, so a freed id is never taken for
+    // one still waiting to move
+    inline auto flush_migrations() -> std::vector<Migration>
+    {
+        std::vector<Detached> detached;
+        detached.reserve(pending_migrations());
+        for (size_t from = 0; from < migration_queues.size(); from++) {
+            auto &src = shards[from];
+            // deleting the sources below edits the queue
+            auto queue = std::exchange(migration_queues[from], {});
+            for (auto [entity, to] : queue) {
+                // an entity queued twice moves once, to its first destination
+                if (!src.alive(entity)) {
+                    continue;
+                }
+                Detached &moving = detached.emplace_back(Detached {{from, entity}, to, {}});
+                std::apply(
+                    [&](auto &...slots) { (take_component(src, entity, slots), ...); }, moving.components
+                );
+                src.delete_entity(entity);
+            }
+        }
+        std::vector<Migration> moved;
+        moved.reserve(detached.size());
+        for (auto &moving : detached) {
+            auto &dst = shards[moving.to];
+            size_t idx = dst.new_entity();
+            std::apply([&](auto &...slots) { (put_component(dst, idx, slots), ...); }, moving.components);
+            moved.push_back({moving.from, {moving.to, idx}});
+        }
+        return moved;
+    }
+
+    // cross-shard query, calls fn(EntityRef, Cs &...) for every entity having all of Cs in any shard
+    template<typename... Cs, typename F>
+        requires are_types_unique_v<Cs...> && (world_t::template are_from_components_v<Cs> && ...)
+    inline void for_each(F &&fn)
+    {
+        for (size_t shard_idx = 0; shard_idx < shards.size(); shard_idx++) {
+            auto &world = shards[shard_idx];
+            for (auto entity : world.template view<Cs...>()) {
+                if (auto opt = world.template get<Cs...>(entity); opt.has_value()) {
+                    std::apply(
+                        [&](Cs &...components) { fn(EntityRef {shard_idx, entity}, components...); }, opt.value()
+                    );
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "ComponentTraits.hpp"
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+// Memory and occupancy snapshot of a World, see World::stats()
+
+struct ComponentStats {
+    std::string_view name;
+    size_t component_size;
+    // entities having the component
+    size_t live;
+    // bytes of the table (one slot per entity slot, used or not), twice that for buffered components
+    size_t capacity_bytes;
+    // bytes actually holding a live component
+    size_t live_bytes;
+    Placement placement = Placement::Default;
+    bool buffered = false;
+    // averages over the ticks reported by World::report_access(), profiled builds only
+    double reads_per_tick = 0;
+    double writes_per_tick = 0;
+};
+
+struct WorldStats {
+    size_t capacity;
+    size_t live_entities;
+    // slots not holding an alive entity (capacity - live)
+    size_t dead_slots;
+    size_t high_water_mark;
+    // dead slots below the high-water mark, iterations still have to skip them
+    size_t holes;
+    size_t growth_events;
+    // bytes copied by increase_capacity since the creation of the world
+    size_t growth_bytes_copied;
+    size_t status_bytes;
+    // group member lists and their position tables, and the bit columns of the query planner
+    size_t index_bytes;
+    // event channel buffers
+    size_t event_bytes;
+    // everything the world holds from the allocator (tables, status, indexes and events)
+    size_t allocated_bytes;
+    std::vector<ComponentStats> components;
+
+    // fraction of the iterated range that is dead
+    [[nodiscard]] inline auto fragmentation() const -> double
+    {
+        return high_water_mark == 0 ? 0.0 : static_cast<double>(holes) / static_cast<double>(high_water_mark);
+    }
+
+    // fraction of the component bytes holding live data, low values mean the dense layout is wasting memory
+    [[nodiscard]] inline auto table_occupancy() const -> double
+    {
+        size_t total = 0;
+        size_t live = 0;
+        for (const auto &component : components) {
+            total += component.capacity_bytes;
+            live += component.live_bytes;
+        }
+        return total == 0 ? 0.0 : static_cast<double>(live) / static_cast<double>(total);
+    }
+
+    friend auto operator<<(std::ostream &os, const WorldStats &stats) -> std::ostream &
+    {
+        auto flags = os.flags();
+        auto precision = os.precision();
+        os << "World: " << stats.live_entities << "/" << stats.capacity << " entities, high-water mark "
+           << stats.high_water_mark << ", " << stats.holes << " holes (" << std::fixed << std::setprecision(1)
+           << stats.fragmentation() * 100 << "% fragmented)\n"
+           << "  allocated " << stats.allocated_bytes << " bytes (status " << stats.status_bytes << ", indexes "
+           << stats.index_bytes << ", events " << stats.event_bytes << "), table occupancy "
+           << stats.table_occupancy() * 100 << "%\n"
+           << "  " << stats.growth_events << " growth events, " << stats.growth_bytes_copied
+           << " bytes copied\n";
+        for (const auto &component : stats.components) {
+            os << "  " << std::left << std::setw(16) << component.name << std::right << std::setw(8)
+               << component.live << " live x " << component.component_size << " bytes, table "
+               << component.capacity_bytes << " bytes, live " << component.live_bytes << " bytes";
+            if (component.placement != Placement::Default) {
+                os << (component.placement == Placement::Hot ? ", hot" : ", cold");
+            }
+            if (component.buffered) {
+                os << ", buffered";
+            }
+            if (component.reads_per_tick != 0 || component.writes_per_tick != 0) {
+                os << ", " << component.reads_per_tick << " reads, " << component.writes_per_tick
+                   << " writes per tick";
+            }
+            os << "\n";
+        }
+        os.flags(flags);
+        os.precision(precision);
+        return os;
+    }
+};
+
+// Prints world.stats() every `interval` seconds of simulated time
+class StatsReporter {
+private:
+    float interval;
+    float elapsed = 0;
+    std::ostream &output;
+
+public:
+    explicit StatsReporter(float interval, std::ostream &output = std::cerr):
+        interval(interval),
+        output(output)
+    {
+    }
+
+    template<class World>
+    inline void update(const World &world, float dt)
+    {
+        elapsed += dt;
+        if (elapsed >= interval) {
+            elapsed = 0;
+            output << world.stats();
+        }
+    }
+};
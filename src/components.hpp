@@ -0,0 +1,147 @@
+#pragma once
+
+#include "ComponentTraits.hpp"
+#include "utils/debug.hpp"
+#include <cstddef>
+#include <cstdint>
+
+struct CPosition {
+    float x, y;
+
+    DERIVE_DEBUG(CPosition, x, y)
+};
+
+struct CVelocity {
+    float x, y;
+
+    DERIVE_DEBUG(CVelocity, x, y)
+};
+
+struct CCollider {
+    enum class Type : uint8_t {
+        Deflecting,
+        Push,
+        Slide,
+    };
+
+    Type type;
+
+    DERIVE_DEBUG(CCollider, type)
+};
+
+// emitted by Scollision_update for every collider overlapping another one, see World::emit
+struct CollisionEvent {
+    size_t entity;
+    size_t other;
+
+    DERIVE_DEBUG(CollisionEvent, entity, other)
+};
+
+struct CSpeed {
+    float horizontal;
+
+    DERIVE_DEBUG(CSpeed, horizontal)
+};
+
+struct CRectangle {
+    float width, height;
+
+    DERIVE_DEBUG(CRectangle, width, height)
+};
+
+struct CColor {
+    uint8_t r, g, b, a;
+
+    CColor() = default;
+    CColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a):
+        r(r),
+        g(g),
+        b(b),
+        a(a)
+    {
+    }
+
+    DERIVE_DEBUG(CColor, r, g, b, a)
+};
+
+struct CInput {
+public:
+    // bitfield
+    enum class Key : uint8_t {
+        None = 0,
+        Up = 1 << 1,
+        Down = 1 << 2,
+        Left = 1 << 3,
+        Right = 1 << 4,
+        Fire = 1 << 5,
+        Spawn = 1 << 6,
+    };
+
+    Key key = Key::None;
+    // cursor position, where Spawn places the new entity
+    float x = 0;
+    float y = 0;
+
+    // automatic conversion to uint8_t
+    operator uint8_t() const { return static_cast<uint8_t>(key); }
+    operator bool() const { return key != Key::None; }
+
+    auto operator&(Key other) const -> bool
+    {
+        return static_cast<uint8_t>(key) & static_cast<uint8_t>(other);
+    }
+
+    auto operator|=(Key other) -> CInput &
+    {
+        key = static_cast<Key>(static_cast<uint8_t>(key) | static_cast<uint8_t>(other));
+        return *this;
+    }
+
+    DERIVE_DEBUG(CInput, key, x, y)
+};
+
+struct CPlayer {
+    DERIVE_DEBUG(CPlayer)
+};
+
+// offset of an entity from the position of its parent in the Hierarchy, see Sattachment_update
+struct CAttachment {
+    float x, y;
+
+    DERIVE_DEBUG(CAttachment, x, y)
+};
+
+// table placement, from the reads per tick of a profiled server run (World::stats() with BECS_PROFILE):
+// positions, rectangles and velocities are read by collision or movement every tick, colors only by the
+// render extraction, input and player by a handful of lookups
+template<>
+struct component_traits<CPosition> {
+    static constexpr Placement placement = Placement::Hot;
+    // the renderer interpolates between the previous and the current position
+    static constexpr bool buffered = true;
+};
+
+template<>
+struct component_traits<CRectangle> {
+    static constexpr Placement placement = Placement::Hot;
+};
+
+template<>
+struct component_traits<CVelocity> {
+    static constexpr Placement placement = Placement::Hot;
+};
+
+template<>
+struct component_traits<CColor> {
+    static constexpr Placement placement = Placement::Cold;
+};
+
+template<>
+struct component_traits<CInput> {
+    static constexpr Placement placement = Placement::Cold;
+};
+
+template<>
+struct component_traits<CPlayer> {
+    static constexpr Placement placement = Placement::Cold;
+};
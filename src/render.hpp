@@ -0,0 +1,70 @@
+#pragma once
+
+// render thread side, talking to raylib (drawing the extracted DrawList and reading the keyboard/mouse)
+// raylib must only be used from the thread that opened the window
+
+#include "RenderExtract.hpp"
+#include "components.hpp"
+#include "raylib.h"
+#include <string>
+
+// the rects are drawn list.alpha of the way from their previous to their current position, the picture
+// lags one tick behind the simulation but moves smoothly whatever the frame rate
+inline void Srectangle_draw(const DrawList &list)
+{
+    for (const auto &rect : list.rects) {
+        float x = rect.previous_x + (rect.x - rect.previous_x) * list.alpha;
+        float y = rect.previous_y + (rect.y - rect.previous_y) * list.alpha;
+        DrawRectangle(
+            static_cast<int>(x), static_cast<int>(y), static_cast<int>(rect.width),
+            static_cast<int>(rect.height), Color {rect.color.r, rect.color.g, rect.color.b, rect.color.a}
+        );
+    }
+}
+
+// print debug information of the player with raylib
+inline void Splayer_draw_debug(const DrawList &list)
+{
+    if (!list.has_player) {
+        return;
+    }
+    const auto &pos = list.player_position;
+    const auto &velocity = list.player_velocity;
+    DrawText(
+        std::string(
+            "Player: x: " + std::to_string(pos.x) + "\ny: " + std::to_string(pos.y) +
+            "\nvx: " + std::to_string(velocity.x) + "\nvy: " + std::to_string(velocity.y) +
+            "\ncolliding: " + (list.player_colliding ? "true" : "false")
+        )
+            .c_str(),
+        10, 10, 16, GREEN
+    );
+}
+
+// samples the keyboard and mouse, the simulation applies it to the players with Sinput_apply
+inline auto Sinput_get() -> CInput
+{
+    CInput input {};
+    if (IsKeyDown(KEY_UP)) {
+        input |= CInput::Key::Up;
+    }
+    if (IsKeyDown(KEY_DOWN)) {
+        input |= CInput::Key::Down;
+    }
+    if (IsKeyDown(KEY_LEFT)) {
+        input |= CInput::Key::Left;
+    }
+    if (IsKeyDown(KEY_RIGHT)) {
+        input |= CInput::Key::Right;
+    }
+    if (IsKeyDown(KEY_SPACE)) {
+        input |= CInput::Key::Fire;
+    }
+    // place a new entity with rectangle on click
+    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+        input |= CInput::Key::Spawn;
+    }
+    input.x = static_cast<float>(GetMouseX());
+    input.y = static_cast<float>(GetMouseY());
+    return input;
+}
@@ -0,0 +1,388 @@
+#pragma once
+
+#include "Hierarchy.hpp"
+#include "Scheduler.hpp"
+#include "components.hpp"
+#include "utils/log.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <span>
+#include <vector>
+
+template<class World>
+void Sgravity_update(World &world, float dt)
+{
+    for (auto entity : world.template view<CVelocity>()) {
+        if (auto opt = world.template get<CVelocity>(entity); opt.has_value()) {
+            auto &[velocity] = opt.value();
+            const float GRAVITY = 9.8f;
+            velocity.y += GRAVITY * dt;
+        }
+    }
+}
+
+template<class World>
+void Smovement_update(World &world, float dt)
+{
+    world.template group<CVelocity, CPosition, CSpeed>().each(
+        [&world, dt](size_t entity, CVelocity &velocity, CPosition &pos, CSpeed &speed) {
+            auto notplayer = !world.template has<CPlayer>(entity);
+
+            if (notplayer) {
+                LOG_DEBUG("Position: ", pos);
+            }
+            pos.x += velocity.x * speed.horizontal * dt;
+            pos.y += velocity.y * speed.horizontal * dt;
+            if (notplayer) {
+                LOG_DEBUG("NEW Position: ", pos, ", ", velocity, ", ", speed, ", ", dt);
+            }
+        }
+    );
+}
+
+// Swept AABB Collision Detection
+// https://www.gamedev.net/tutorials/programming/general-and-gameplay-programming/swept-aabb-collision-detection-and-response-r3084/
+inline float swept_aabb(
+    CPosition &pos1, CRectangle &rect1, CVelocity &vel1, CPosition &pos2, CRectangle &rect2, CVelocity &vel2,
+    float &normalx, float &normaly
+)
+{
+    float xInvEntry, yInvEntry;
+    float xInvExit, yInvExit;
+
+    // find the distance between the objects on the near and far sides for both x and y
+    if (vel1.x > 0.0f) {
+        xInvEntry = pos2.x - (pos1.x + rect1.width);
+        xInvExit = (pos2.x + rect2.width) - pos1.x;
+    } else {
+        xInvEntry = (pos2.x + rect2.width) - pos1.x;
+        xInvExit = pos2.x - (pos1.x + rect1.width);
+    }
+
+    if (vel1.y > 0.0f) {
+        yInvEntry = pos2.y - (pos1.y + rect1.height);
+        yInvExit = (pos2.y + rect2.height) - pos1.y;
+    } else {
+        yInvEntry = (pos2.y + rect2.height) - pos1.y;
+        yInvExit = pos2.y - (pos1.y + rect1.height);
+    }
+
+    // find time of collision and time of leaving for each axis (if statement is to prevent divide by zero)
+    float xEntry = 0.0f, yEntry = 0.0f;
+    float xExit = 0.0f, yExit = 0.0f;
+
+    if (vel1.x == 0.0f) {
+        xEntry = -std::numeric_limits<float>::infinity();
+        xExit = std::numeric_limits<float>::infinity();
+    } else {
+        xEntry = xInvEntry / vel1.x;
+        xExit = xInvExit / vel1.x;
+    }
+
+    if (vel1.y == 0.0f) {
+        yEntry = -std::numeric_limits<float>::infinity();
+        yExit = std::numeric_limits<float>::infinity();
+    } else {
+        yEntry = yInvEntry / vel1.y;
+        yExit = yInvExit / vel1.y;
+    }
+
+    // find the earliest/latest times of collision
+    float entryTime = std::max(xEntry, yEntry);
+    float exitTime = std::min(xExit, yExit);
+
+    // if there was no collision
+    if (entryTime > exitTime || xEntry < 0.0f && yEntry < 0.0f || xEntry > 1.0f || yEntry > 1.0f) {
+        normalx = 0.0f;
+        normaly = 0.0f;
+        return 1.0f;
+    } else {
+        // calculate normal of collided surface
+        if (xEntry > yEntry) {
+            if (xInvEntry < 0.0f) {
+                normalx = 1.0f;
+                normaly = 0.0f;
+            } else {
+                normalx = -1.0f;
+                normaly = 0.0f;
+            }
+        } else {
+            if (yInvEntry < 0.0f) {
+                normalx = 0.0f;
+                normaly = 1.0f;
+            } else {
+                normalx = 0.0f;
+                normaly = -1.0f;
+            }
+        }
+
+        return entryTime;
+    }
+}
+
+template<class World>
+void Scollision_update(World &world, float dt)
+{
+    // AABB collision detection
+    for (auto entity : world.template view<CPosition, CRectangle, CCollider, CVelocity>()) {
+        if (auto opt = world.template get<CPosition, CRectangle, CCollider, CVelocity>(entity);
+            opt.has_value()) {
+            auto &[pos, rect, collision, velocity] = opt.value();
+            auto nearest_collision = std::numeric_limits<size_t>::max();
+            for (auto other : world.template view<CPosition, CRectangle, CCollider>()) {
+                if (entity == other) {
+                    continue;
+                }
+                auto opt_other = world.template get<CPosition, CRectangle, CCollider>(other);
+                // safe to unwrap since we know the entity exists, since we are iterating over it
+                auto &[pos_other, rect_other, collision_other] = opt_other.value();
+                // auto collision_distance = std::max(
+                //     std::max(pos.x - (pos_other.x + rect_other.width), pos_other.x - (pos.x + rect.width)),
+                //     std::max(pos.y - (pos_other.y + rect_other.height), pos_other.y - (pos.y +
+                //     rect.height))
+                // );
+                if (pos.x < pos_other.x + rect_other.width && pos.x + rect.width > pos_other.x &&
+                    pos.y < pos_other.y + rect_other.height && pos.y + rect.height > pos_other.y) {
+                    // Only supports 1 collision at a time (should take the nearest collision)
+                    nearest_collision = other;
+                }
+            }
+            if (nearest_collision != std::numeric_limits<size_t>::max()) {
+                world.emit(CollisionEvent {entity, nearest_collision});
+            }
+        }
+    }
+
+    // Swept AABB collision detection
+    auto events = world.template events<CollisionEvent>();
+    for (size_t i = 0; i < events.size(); i++) {
+        // the other entity is a random row, its components are fetched a few events ahead
+        if (i + World::defaultPrefetchDistance < events.size()) {
+            world.template prefetch<CCollider, CPosition, CRectangle>(
+                events[i + World::defaultPrefetchDistance].other
+            );
+        }
+        const auto &event = events[i];
+        if (auto opt = world.template get<CVelocity, CPosition, CSpeed, CRectangle>(event.entity);
+            opt.has_value()) {
+            auto &[velocity, position, speed, rect] = opt.value();
+            auto opt_other = world.template get<CCollider, CPosition, CRectangle>(event.other);
+            // safe to unwrap since the event was emitted this tick and we destroy entities at the end
+            auto &[collision_other, position_other, rect_other] = opt_other.value();
+            float normalx;
+            float normaly;
+            CVelocity velocity_other {0, 0};
+            auto collision_time = swept_aabb(
+                position, rect, velocity, position_other, rect_other, velocity_other, normalx, normaly
+            );
+            position.x -= velocity.x * speed.horizontal * collision_time * dt;
+            position.y -= velocity.y * speed.horizontal * collision_time * dt;
+            if (!world.template has<CPlayer>(event.entity)) {
+                LOG_DEBUG("Collision time: ", collision_time);
+                LOG_DEBUG("New Position: ", position);
+            }
+            float remaining_time = 1.0f - collision_time;
+            // slide
+            float dotprod = (velocity.x * normaly + velocity.y * normalx) * remaining_time;
+            velocity.x = dotprod * normaly;
+            velocity.y = dotprod * normalx;
+        }
+    }
+}
+
+// true when entity collided with something this tick
+template<class World>
+auto is_colliding(const World &world, size_t entity) -> bool
+{
+    auto events = world.template events<CollisionEvent>();
+    return std::any_of(events.begin(), events.end(), [entity](const CollisionEvent &event) {
+        return event.entity == entity;
+    });
+}
+
+template<class World>
+void Splayer_rectangle_update(World &world)
+{
+    for (auto entity : world.template view<CPlayer, CPosition, CRectangle, CColor>()) {
+        if (auto opt = world.template get<CPlayer, CPosition, CRectangle, CColor>(entity); opt.has_value()) {
+            auto &[_, pos, rect, color] = opt.value();
+            if (is_colliding(world, entity)) {
+                color = CColor {0, 255, 0, 255};
+            } else {
+                color = CColor {255, 0, 0, 255};
+            }
+        }
+    }
+}
+
+// moves attached entities to the position of their parent plus their offset, one depth at a time so
+// that a parent has reached its place before its children follow it
+template<class World>
+void Sattachment_update(World &world, Hierarchy &hierarchy)
+{
+    hierarchy.each_level([&world](std::span<const Hierarchy::Link> links) {
+        for (const auto &link : links) {
+            auto parent = world.template get<CPosition>(link.parent);
+            auto child = world.template get<CPosition, CAttachment>(link.child);
+            if (parent.has_value() && child.has_value()) {
+                auto &[parent_pos] = parent.value();
+                auto &[pos, offset] = child.value();
+                pos = CPosition {parent_pos.x + offset.x, parent_pos.y + offset.y};
+            }
+        }
+    });
+}
+
+// copies the input sampled by the render thread into every player
+template<class World>
+void Sinput_apply(World &world, const CInput &sampled)
+{
+    for (auto entity : world.template view<CInput, CPlayer>()) {
+        if (auto opt = world.template get<CInput, CPlayer>(entity); opt.has_value()) {
+            auto &[input, _] = opt.value();
+            input = sampled;
+        }
+    }
+}
+
+template<class World>
+void Splayer_update_direction(World &world)
+{
+    for (auto entity : world.template view<CInput, CVelocity>()) {
+        if (auto opt = world.template get<CInput, CVelocity>(entity); opt.has_value()) {
+            auto &[input, velocity] = opt.value();
+            velocity.x = 0;
+            velocity.y = 0;
+            if (input & CInput::Key::Up) {
+                velocity.y = -1;
+            }
+            if (input & CInput::Key::Down) {
+                velocity.y = 1;
+            }
+            if (input & CInput::Key::Left) {
+                velocity.x = -1;
+            }
+            if (input & CInput::Key::Right) {
+                velocity.x = 1;
+            }
+        }
+    }
+}
+
+// spawns a box under the cursor of the players pressing Spawn, then sleeps through the cooldown
+template<class World>
+auto Splayer_SpawnEntity(World &world, Scheduler &scheduler) -> Task
+{
+    const float spawn_cooldown = 1.0f;
+
+    for (;;) {
+        co_await scheduler.next_tick();
+        // entities are created after the iteration, new_entity may grow the tables under the view
+        std::vector<CPosition> spawns;
+        for (auto entity : world.template view<CInput>()) {
+            if (auto opt = world.template get<CInput>(entity); opt.has_value()) {
+                auto &[input] = opt.value();
+                if (input & CInput::Key::Spawn) {
+                    spawns.push_back(CPosition {input.x, input.y});
+                }
+            }
+        }
+        for (const auto &position : spawns) {
+            auto spawned = world.try_new_entity();
+            if (!spawned.has_value()) {
+                LOG_WARN("World full, spawn dropped");
+                break;
+            }
+            auto new_entity = *spawned;
+            LOG_INFO("New entity: ", new_entity);
+            world.template emplace<CPosition>(new_entity, position);
+            world.template emplace<CRectangle>(new_entity, 40.0f, 40.0f);
+            world.template emplace<CColor>(new_entity, 255, 0, 0, 255);
+            world.template emplace<CCollider>(new_entity);
+            world.template emplace<CSpeed>(new_entity, 100.0f);
+            world.template emplace<CVelocity>(
+                new_entity, std::numeric_limits<float>::epsilon(), std::numeric_limits<float>::epsilon()
+            );
+        }
+        if (!spawns.empty()) {
+            co_await scheduler.wait(spawn_cooldown);
+        }
+    }
+}
+
+template<class World>
+void init_entities(World &world)
+{
+    auto player = world.new_entity();
+    world.template add<CPosition>(player, CPosition {400, 300});
+    world.template add<CRectangle>(player, CRectangle {40, 40});
+    world.template add<CColor>(player, CColor {255, 0, 0, 255});
+    world.template add<CInput>(player, CInput {CInput::Key::None});
+    world.template add<CCollider>(player, CCollider {});
+    world.template add<CSpeed>(player, CSpeed {100});
+    world.template add<CVelocity>(player, CVelocity {0, 0});
+    world.template add<CPlayer>(player, CPlayer {});
+
+    auto floor = world.new_entity(); // bottom floor
+    world.template add<CPosition>(floor, CPosition {0, 500});
+    world.template add<CRectangle>(floor, CRectangle {800, 100});
+    world.template add<CColor>(floor, CColor {0, 0, 255, 255});
+    world.template add<CCollider>(floor, CCollider {});
+
+    auto wall = world.new_entity(); // top wall
+    world.template add<CPosition>(wall, CPosition {0, 0});
+    world.template add<CRectangle>(wall, CRectangle {800, 100});
+    world.template add<CColor>(wall, CColor {0, 0, 255, 255});
+    world.template add<CCollider>(wall, CCollider {});
+
+    // ball that bounces up and down
+    auto ball = world.new_entity();
+    world.template add<CPosition>(ball, CPosition {400, 100});
+    world.template add<CRectangle>(ball, CRectangle {20, 20});
+    world.template add<CColor>(ball, CColor {0, 25, 178, 255});
+    world.template add<CCollider>(ball, CCollider {});
+    world.template add<CSpeed>(ball, CSpeed {100});
+    world.template add<CVelocity>(ball, CVelocity {0, 1});
+}
+
+// the weapon carried by the player, moved along by Sattachment_update
+template<class World>
+void init_attachments(World &world, Hierarchy &hierarchy)
+{
+    std::vector<size_t> players;
+    for (auto player : world.template view<CPlayer, CPosition>()) {
+        players.push_back(player);
+    }
+    for (auto player : players) {
+        auto weapon = world.new_entity();
+        world.template add<CPosition>(weapon, CPosition {0, 0});
+        world.template add<CRectangle>(weapon, CRectangle {30, 8});
+        world.template add<CColor>(weapon, CColor {60, 60, 60, 255});
+        world.template add<CAttachment>(weapon, CAttachment {40, 16});
+        hierarchy.set_parent(weapon, player);
+    }
+}
+
+// scatters count falling boxes over a width x height area, used to load the simulation
+template<class World>
+void init_boxes(World &world, size_t count, float width, float height, unsigned seed = 42)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> x(0, width);
+    std::uniform_real_distribution<float> y(100, height);
+    std::uniform_int_distribution<int> shade(0, 255);
+    for (size_t i = 0; i < count; i++) {
+        auto box = world.new_entity();
+        // the generator is drawn in a fixed order, replays depend on it
+        float box_x = x(rng);
+        float box_y = y(rng);
+        world.template emplace<CPosition>(box, box_x, box_y);
+        world.template emplace<CRectangle>(box, 10.0f, 10.0f);
+        world.template emplace<CColor>(box, static_cast<uint8_t>(shade(rng)), 80, 80, 255);
+        world.template emplace<CCollider>(box);
+        world.template emplace<CSpeed>(box, 50.0f);
+        world.template emplace<CVelocity>(box, 0.0f, 1.0f);
+    }
+}
@@ -1,12 +1,35 @@
 #ifdef TEST
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono> // For std::chrono
+#include <csignal>
 #include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream> // For std::cout, std::endl
 #include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "ComponentStatus.hpp"
+#include "Hierarchy.hpp"
+#include "MappedStorage.hpp"
+#include "RenderExtract.hpp"
+#include "Replay.hpp"
+#include "Scheduler.hpp"
+#include "StaticStorage.hpp"
+#include "Streaming.hpp"
 #include "World.hpp"
+#include "WorldShard.hpp"
+#include "utils/log.hpp"
+#include "utils/reflect.hpp"
 
 struct Position {
     float x;
@@ -18,9 +41,13 @@ struct Position {
         os << "Position: (" << pos.x << ", " << pos.y << ", " << pos.z << ")";
         return os;
     }
+
+    REFLECT(Position, x, y, z)
 };
 struct Level {
     int value;
+
+    REFLECT(Level, value)
 };
 struct C { };
 struct D { };
@@ -44,8 +71,1318 @@ auto measure(F &&f)
     return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
 }
 
+// aborts on the first expectation that does not hold
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            std::abort();                                                                  \
+        }                                                                                  \
+    } while (false)
+
+// queued migrations move the components, a deleted entity never moves, even once its id is reused
+static void test_shard_migrations()
+{
+    WorldShard<Position, Level> sharded(3, 2);
+    auto stale = sharded.new_entity(1);
+    std::vector<WorldShard<Position, Level>::EntityRef> refs;
+    for (int i = 0; i < 4; i++) {
+        refs.push_back(sharded.new_entity(0));
+        sharded.shard(0).add<Level>(refs.back().entity, Level {i});
+    }
+    sharded.migrate(stale, 2);
+    sharded.delete_entity(stale);
+    sharded.migrate(refs[3], 1);
+    sharded.migrate(refs[1], 2);
+    sharded.migrate(refs[1], 1);
+    CHECK(sharded.pending_migrations() == 3);
+    auto moved = sharded.flush_migrations();
+    CHECK(moved.size() == 2);
+    CHECK(sharded.pending_migrations() == 0);
+    CHECK(sharded.shard(0).size() == 2);
+    CHECK(sharded.shard(1).size() == 1);
+    CHECK(sharded.shard(2).size() == 1);
+    for (const auto &migration : moved) {
+        CHECK(!sharded.shard(0).alive(migration.from.entity));
+        auto [level] = sharded.shard(migration.to.shard).get<Level>(migration.to.entity).value();
+        CHECK(level.value == static_cast<int>(migration.from.entity));
+    }
+    CHECK(moved[0].to.shard == 1);
+    CHECK(moved[1].to.shard == 2);
+}
+
+// rebalance sends every entity to the shard of its position, step() visits each shard once
+static void test_shard_rebalance()
+{
+    WorldShard<Position, Level> sharded(4, 3);
+    for (int i = 0; i < 40; i++) {
+        auto ref = sharded.new_entity(0);
+        sharded.shard(0).add<Position>(ref.entity, Position {static_cast<float>(i), 0, 0});
+        sharded.shard(0).add<Level>(ref.entity, Level {i});
+    }
+    sharded.rebalance<Position>([](const Position &pos) { return static_cast<size_t>(pos.x) / 10; });
+    sharded.flush_migrations();
+    CHECK(sharded.size() == 40);
+    int level_sum = 0;
+    sharded.for_each<Position, Level>([&level_sum](auto ref, Position &pos, Level &level) {
+        CHECK(static_cast<size_t>(pos.x) / 10 == ref.shard);
+        CHECK(static_cast<int>(pos.x) == level.value);
+        level_sum += level.value;
+    });
+    CHECK(level_sum == 39 * 40 / 2);
+    std::array<std::atomic<int>, 4> visits {};
+    for (int tick = 0; tick < 10; tick++) {
+        sharded.step([&visits](World<Position, Level> &world, size_t shard) {
+            CHECK(world.size() == 10);
+            visits[shard]++;
+        });
+    }
+    for (const auto &count : visits) {
+        CHECK(count == 10);
+    }
+}
+
+// declaring a group must not move the groups whose views are still held
+static void test_group_views()
+{
+    World<Position, Level, int> world;
+    for (size_t i = 0; i < 10; i++) {
+        auto entity = world.new_entity();
+        world.add<Position>(entity, Position {static_cast<float>(i), 0, 0});
+        world.add<Level>(entity, Level {static_cast<int>(i)});
+        if (i % 2 == 0) {
+            world.add<int>(entity, static_cast<int>(i));
+        }
+    }
+    auto first = world.group<Position, Level>();
+    auto second = world.group<Position, int>();
+    auto third = world.group<Level, int>();
+    CHECK(first.size() == 10);
+    CHECK(second.size() == 5);
+    CHECK(third.size() == 5);
+    world.delete_entity(4);
+    CHECK(first.size() == 9);
+    CHECK(third.size() == 4);
+    CHECK(std::find(first.begin(), first.end(), 4) == first.end());
+    int sum = 0;
+    third.each([&sum](size_t, Level &level, int &value) { sum += level.value + value; });
+    CHECK(sum == 2 * (0 + 2 + 6 + 8));
+}
+
+// sort_by spread over many calls: the remaps keep ids held outside the world valid, even when entities
+// are created or deleted during a pass, and an unbounded call leaves the world fully sorted
+static void test_incremental_sort()
+{
+    World<Position, Level> world;
+    // where[level]: id of the entity created with that level, npos once deleted
+    constexpr size_t gone = static_cast<size_t>(-1);
+    std::vector<size_t> where;
+    auto spawn = [&](float x, bool positioned) {
+        auto entity = world.new_entity();
+        world.add<Level>(entity, Level {static_cast<int>(where.size())});
+        if (positioned) {
+            world.add<Position>(entity, Position {x, 0, 0});
+        }
+        where.push_back(entity);
+    };
+    auto follow = [&](const auto &remaps) {
+        std::vector<size_t> moved = where;
+        for (const auto &remap : remaps) {
+            auto found = std::find(where.begin(), where.end(), remap.from);
+            CHECK(found != where.end());
+            moved[found - where.begin()] = remap.to;
+        }
+        where = moved;
+        for (size_t level = 0; level < where.size(); level++) {
+            if (where[level] != gone) {
+                auto [found] = world.get<Level>(where[level]).value();
+                CHECK(found.value == static_cast<int>(level));
+            }
+        }
+    };
+    auto key = [](const Position &pos) { return pos.x; };
+    for (size_t i = 0; i < 100; i++) {
+        spawn(static_cast<float>((i * 37) % 100), i % 5 != 0);
+    }
+    for (size_t i = 0; i < 100; i += 7) {
+        world.delete_entity(where[i]);
+        where[i] = gone;
+    }
+    for (int call = 0; call < 40; call++) {
+        follow(world.sort_by<Position>(key, 8));
+        if (call == 3) {
+            spawn(-1, true);
+            world.delete_entity(where[50]);
+            where[50] = gone;
+        }
+    }
+    follow(world.sort_by<Position>(key));
+    size_t alive = world.size();
+    float last = -2;
+    bool positioned = true;
+    for (size_t idx = 0; idx < alive; idx++) {
+        CHECK(world.alive(idx));
+        if (auto pos = world.get<Position>(idx); pos.has_value()) {
+            CHECK(positioned);
+            CHECK(std::get<0>(pos.value()).x >= last);
+            last = std::get<0>(pos.value()).x;
+        } else {
+            positioned = false;
+        }
+    }
+    CHECK(std::get<0>(world.get<Position>(0).value()).x == -1);
+}
+
+static_assert(!logging::enabled(logging::Level::Debug) && logging::enabled(logging::Level::Info));
+
+// levels below BECS_LOG_LEVEL (Info here) are compiled out, the others come out in order, also once the
+// ring of the thread has wrapped around several times
+static void test_logger()
+{
+    std::ostringstream captured;
+    logging::flush();
+    logging::set_output(captured);
+    int evaluated = 0;
+    LOG_TRACE("trace ", ++evaluated);
+    LOG_DEBUG("debug ", ++evaluated);
+    LOG_INFO("info ", 1);
+    LOG_WARN("warn ", 2.5);
+    LOG_ERROR("error ", 'x');
+    logging::flush();
+    CHECK(evaluated == 0);
+    CHECK(captured.str() == "info 1\n[warn] warn 2.5\n[error] error x\n");
+
+    // 48 byte records: a round fills most of the 64 KiB ring, the next ones wrap over its end
+    captured.str("");
+    std::ostringstream expected;
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 1200; i++) {
+            LOG_INFO("record ", round * 1200 + i);
+            expected << "record " << round * 1200 + i << "\n";
+        }
+        logging::flush();
+    }
+    logging::set_output(std::cout);
+    CHECK(captured.str() == expected.str());
+}
+
+#ifdef BECS_PROFILE
+// a thread that exits hands its events and its buffer back, the next thread records into that buffer
+static void test_profiler_thread_exit()
+{
+    auto record = []() { std::thread([]() { PROFILE_ZONE("test/exited"); }).join(); };
+    record();
+    size_t buffers = profiler::Profiler::instance().buffer_count();
+    record();
+    record();
+    CHECK(profiler::Profiler::instance().buffer_count() == buffers);
+    auto stats = profiler::Profiler::instance().statistics();
+    auto exited = std::find_if(stats.begin(), stats.end(), [](const auto &zone) {
+        return zone.name == "test/exited";
+    });
+    CHECK(exited != stats.end() && exited->samples == 3);
+}
+#endif
+
+// the snapshot agrees with the world: counts, holes, growth copies and the bytes of every part
+static void test_world_stats()
+{
+    World<Position, Level> world;
+    WorldStats empty = world.stats();
+    CHECK(empty.live_entities == 0 && empty.high_water_mark == 0 && empty.growth_events == 0);
+    size_t initial = empty.capacity;
+    for (size_t i = 0; i < initial; i++) {
+        world.add<Position>(world.new_entity(), Position {0, 0, 0});
+    }
+    CHECK(world.stats().growth_events == 0);
+    // the next entity grows every table, the old slots are copied
+    world.new_entity();
+    WorldStats grown = world.stats();
+    CHECK(grown.growth_events == 1 && grown.capacity > initial);
+    CHECK(grown.growth_bytes_copied >= initial * (sizeof(Position) + sizeof(Level)));
+    CHECK(grown.growth_bytes_copied < initial * (sizeof(Position) + sizeof(Level) + 16));
+
+    for (size_t i = 0; i < 100; i++) {
+        auto entity = world.new_entity();
+        world.add<Level>(entity, Level {static_cast<int>(i)});
+        if (i % 4 == 0) {
+            world.add<Position>(entity, Position {1, 1, 1});
+        }
+    }
+    // deleted below the high-water mark: holes
+    for (size_t entity = 20; entity < 30; entity++) {
+        world.delete_entity(entity);
+    }
+    WorldStats stats = world.stats();
+    size_t alive = initial + 1 + 100 - 10;
+    CHECK(stats.live_entities == alive && stats.high_water_mark == initial + 101);
+    CHECK(stats.holes == 10 && stats.dead_slots == stats.capacity - alive);
+    CHECK(stats.fragmentation() == 10.0 / static_cast<double>(initial + 101));
+    CHECK(stats.components.size() == 2 && stats.components[0].name == "Position");
+    size_t positions = 0;
+    size_t levels = 0;
+    for (auto entity : world) {
+        positions += world.has<Position>(entity) ? 1 : 0;
+        levels += world.has<Level>(entity) ? 1 : 0;
+    }
+    for (const auto &component : stats.components) {
+        size_t live = component.name == "Position" ? positions : levels;
+        CHECK(component.live == live);
+        CHECK(component.live_bytes == live * component.component_size);
+        CHECK(component.capacity_bytes >= stats.capacity * component.component_size);
+    }
+    CHECK(stats.components[1].live == 100 - 10);
+    CHECK(stats.table_occupancy() > 0 && stats.table_occupancy() <= 1);
+
+    // a group and some events add to the indexes and the event bytes
+    size_t index_bytes = stats.index_bytes;
+    auto group = world.group<Position, Level>();
+    world.emit(Level {1});
+    WorldStats indexed = world.stats();
+    CHECK(indexed.index_bytes >= index_bytes + group.size() * sizeof(size_t));
+    CHECK(indexed.event_bytes >= sizeof(Level));
+    CHECK(indexed.allocated_bytes == indexed.status_bytes + indexed.index_bytes + indexed.event_bytes +
+                                         indexed.components[0].capacity_bytes +
+                                         indexed.components[1].capacity_bytes);
+}
+
+// the consumer only ever gets whole frames, in publish order, and the last one before close()
+static void test_double_buffer()
+{
+    constexpr uint64_t frames = 2000;
+    DoubleBuffer<DrawList> buffer;
+    std::thread producer([&buffer]() {
+        for (uint64_t tick = 1; tick <= frames; tick++) {
+            DrawList &list = buffer.back();
+            list.clear();
+            list.tick = tick;
+            // every rect of a frame carries its tick, a torn frame mixes two of them
+            for (uint64_t i = 0; i < 1 + tick % 7; i++) {
+                DrawRect rect {};
+                rect.x = static_cast<float>(tick);
+                list.rects.push_back(rect);
+            }
+            buffer.publish();
+        }
+        buffer.close();
+    });
+    uint64_t last = 0;
+    uint64_t seen = 0;
+    auto check_frame = [&](const DrawList &list) {
+        CHECK(list.tick > last);
+        CHECK(list.rects.size() == 1 + list.tick % 7);
+        for (const auto &rect : list.rects) {
+            CHECK(rect.x == static_cast<float>(list.tick));
+        }
+        last = list.tick;
+        seen++;
+    };
+    while (buffer.consume(check_frame)) {
+    }
+    producer.join();
+    CHECK(last == frames);
+    CHECK(buffer.frames_published() == frames);
+    CHECK(buffer.frames_consumed() == seen);
+
+    // close() wakes up a consumer waiting for a frame that never comes
+    DoubleBuffer<int> idle;
+    CHECK(!idle.consume([](const int &) { CHECK(false); }, std::chrono::milliseconds(1)));
+    std::thread closer([&idle]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        idle.close();
+    });
+    CHECK(!idle.consume([](const int &) { CHECK(false); }));
+    closer.join();
+}
+
+// the simulation takes the latest input, a spawn click is kept until taken once
+static void test_input_mailbox()
+{
+    InputMailbox mailbox;
+    mailbox.push(CInput {CInput::Key::Up, 1, 1});
+    mailbox.push(CInput {CInput::Key::Left, 3, 4});
+    CInput taken = mailbox.take();
+    CHECK((taken & CInput::Key::Left) && !(taken & CInput::Key::Up));
+    CHECK(taken.x == 3 && taken.y == 4);
+    mailbox.push(CInput {CInput::Key::Spawn, 5, 5});
+    mailbox.push(CInput {CInput::Key::Down, 6, 6});
+    taken = mailbox.take();
+    CHECK((taken & CInput::Key::Spawn) && (taken & CInput::Key::Down));
+    taken = mailbox.take();
+    CHECK(!(taken & CInput::Key::Spawn) && (taken & CInput::Key::Down));
+}
+
+using ReplayWorld = World<Position, Level>;
+
+// a recorded run replays to the same state hashes, the first tick whose state differs is reported
+static void test_replay_round_trip()
+{
+    // reference values of FNV-1a 64
+    fnv::Hasher hash;
+    CHECK(hash.value() == 0xcbf29ce484222325ULL);
+    hash.mix("a");
+    CHECK(hash.value() == 0xaf63dc4c8601ec8cULL);
+
+    auto path = (std::filesystem::temp_directory_path() / "becs_test_replay.bin").string();
+    auto setup = [](ReplayWorld &world, uint32_t entities) {
+        for (uint32_t i = 0; i < entities; i++) {
+            auto entity = world.new_entity();
+            world.add<Position>(entity, Position {static_cast<float>(i), 0, 0});
+            world.add<Level>(entity, Level {0});
+        }
+    };
+    // the cursor moves every entity, the key bits add to their level
+    auto simulate = [](ReplayWorld &world, const CInput &input) {
+        for (auto entity : world.view<Position, Level>()) {
+            auto [pos, level] = world.get<Position, Level>(entity).value();
+            pos.x += input.x;
+            pos.y += input.y;
+            level.value += static_cast<uint8_t>(input);
+        }
+    };
+    {
+        ReplayWorld world;
+        setup(world, 10);
+        ReplayWriter writer(path, ReplayHeader {.entities = 10});
+        CHECK(writer.is_open());
+        for (int tick = 0; tick < 50; tick++) {
+            CInput input {tick % 3 == 0 ? CInput::Key::Left : CInput::Key::Up, 0.5f * tick, -1.0f * tick};
+            simulate(world, input);
+            writer.write(1.0f / 60.0f, input, state_hash<Position, Level>(world));
+        }
+        CHECK(writer.size() == 50);
+    }
+    // tick `perturbed` (counted from 1) also moves entity 3, returns the first diverged tick or 0
+    auto replay = [&](uint64_t perturbed) -> uint64_t {
+        ReplayReader reader(path);
+        CHECK(reader.is_valid() && reader.header().entities == 10);
+        ReplayWorld world;
+        setup(world, reader.header().entities);
+        TickRecord record {};
+        uint64_t ticks = 0;
+        uint64_t diverged = 0;
+        while (reader.next(record)) {
+            ticks++;
+            CHECK(record.dt == 1.0f / 60.0f);
+            simulate(world, record.input());
+            if (ticks == perturbed) {
+                std::get<0>(world.get<Position>(3).value()).z += 1;
+            }
+            if (diverged == 0 && state_hash<Position, Level>(world) != record.state_hash) {
+                diverged = ticks;
+            }
+        }
+        CHECK(ticks == 50);
+        return diverged;
+    };
+    CHECK(replay(0) == 0);
+    CHECK(replay(20) == 20);
+    std::filesystem::resize_file(path, 6);
+    CHECK(!ReplayReader(path).is_valid());
+    std::filesystem::remove(path);
+}
+
+struct Padded {
+    uint8_t tag;
+    uint32_t value;
+
+    DERIVE_DEBUG(Padded, tag, value)
+};
+
+static_assert(reflect::field_count<Padded> == 2);
+static_assert(reflect::fields_size<Padded> == 5 && !reflect::is_packed<Padded>);
+static_assert(std::get<1>(reflect::fields<Padded>()).offset == offsetof(Padded, value));
+static_assert(reflect::is_packed<Position>);
+
+// fields come in declaration order, and the state hash only covers their bytes, never the padding
+static void test_reflection()
+{
+    std::vector<std::string_view> names;
+    Padded padded {};
+    reflect::for_each_field<Padded>([&](const auto &field) {
+        names.push_back(field.name);
+        field.get(padded) = 7;
+    });
+    CHECK((names == std::vector<std::string_view> {"tag", "value"}));
+    std::ostringstream printed;
+    printed << padded;
+    CHECK(printed.str() == "Padded(7, 7)");
+
+    World<Padded> zeroed;
+    World<Padded> filled;
+    auto store = [](World<Padded> &world, unsigned char fill, uint32_t value) {
+        auto entity = world.new_entity();
+        world.add<Padded>(entity, Padded {});
+        Padded &slot = std::get<0>(world.get<Padded>(entity).value());
+        std::memset(static_cast<void *>(&slot), fill, sizeof(Padded));
+        slot.tag = 1;
+        slot.value = value;
+    };
+    store(zeroed, 0x00, 2);
+    store(filled, 0xff, 2);
+    CHECK(state_hash<Padded>(zeroed) == state_hash<Padded>(filled));
+    std::get<0>(filled.get<Padded>(0).value()).value = 3;
+    CHECK(state_hash<Padded>(zeroed) != state_hash<Padded>(filled));
+}
+
+// a mapped world reopened from its files has the same entities, components and free slots, opening
+// them as a world with other components aborts and leaves them as they were
+static void test_mapped_reopen()
+{
+    auto directory = (std::filesystem::temp_directory_path() / "becs_test_mapped").string();
+    std::filesystem::remove_all(directory);
+    auto check_saved = [&directory](size_t entities) {
+        MappedWorld<Position, Level> world(MappedStorage {directory});
+        CHECK(world.size() == entities);
+        CHECK(world.count<Level>() == entities);
+        CHECK(world.count<Position>() == 249);
+        CHECK(!world.alive(8));
+        auto [pos, level] = world.get<Position, Level>(12).value();
+        CHECK(pos.x == 12 && pos.y == 1 && pos.z == 2);
+        CHECK(level.value == 12);
+        CHECK(!world.has<Position>(13));
+    };
+    {
+        MappedWorld<Position, Level> world(MappedStorage {directory});
+        CHECK(world.size() == 0);
+        for (int i = 0; i < 1000; i++) {
+            auto entity = world.new_entity();
+            world.add<Level>(entity, Level {i});
+            if (i % 4 == 0) {
+                world.add<Position>(entity, Position {static_cast<float>(i), 1, 2});
+            }
+        }
+        world.delete_entity(8);
+        world.flush();
+    }
+    check_saved(999);
+    pid_t child = fork();
+    if (child == 0) {
+        MappedWorld<Level> other(MappedStorage {directory});
+        std::_Exit(0);
+    }
+    int status = 0;
+    CHECK(waitpid(child, &status, 0) == child);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+    check_saved(999);
+    {
+        MappedWorld<Position, Level> world(MappedStorage {directory});
+        CHECK(world.new_entity() == 8);
+        CHECK(world.new_entity() == 1000);
+    }
+    std::filesystem::remove_all(directory);
+}
+
+// entities created by several workers become visible at commit: counts, groups, holes (and observers)
+static void test_concurrent_commit()
+{
+    World<Position, Level> world;
+    for (int i = 0; i < 10; i++) {
+        world.add<Level>(world.new_entity(), Level {i});
+    }
+    world.delete_entity(3);
+    auto group = world.group<Position, Level>();
+    std::vector<size_t> observed;
+    world.on_add<Position>([&observed](std::span<const size_t> entities) {
+        observed.insert(observed.end(), entities.begin(), entities.end());
+    });
+    {
+        auto scope = world.concurrent(4000, 16);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&scope, t]() {
+                auto worker = scope.worker();
+                if (t == 0) {
+                    worker.add<Position>(0, Position {0, 0, 0});
+                }
+                for (int made = 0; made < 500; made++) {
+                    auto entity = worker.new_entity();
+                    CHECK(entity.has_value());
+                    worker.add<Position>(entity.value(), Position {static_cast<float>(entity.value()), 0, 0});
+                    worker.add<Level>(entity.value(), Level {static_cast<int>(entity.value())});
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        CHECK(world.size() == 9);
+        scope.commit();
+    }
+    CHECK(world.size() == 9 + 2000);
+    CHECK(world.count<Position>() == 2001);
+    CHECK(world.count<Level>() == 2009);
+    CHECK(group.size() == 2001);
+    std::sort(observed.begin(), observed.end());
+    CHECK(observed.size() == 2001);
+    CHECK(std::adjacent_find(observed.begin(), observed.end()) == observed.end());
+    CHECK(observed.front() == 0);
+    group.each([](size_t entity, Position &pos, Level &level) {
+        CHECK(static_cast<size_t>(pos.x) == entity);
+        CHECK(static_cast<size_t>(level.value) == entity);
+    });
+    CHECK(world.new_entity() == 3);
+}
+
+using PlannedWorld = World<Position, Level, C>;
+
+// ids of the alive entities having all of Cs, testing every one of them
+template<typename... Cs>
+static auto scan_all(PlannedWorld &world) -> std::vector<size_t>
+{
+    std::vector<size_t> result;
+    for (auto entity : world) {
+        if (world.has<Cs...>(entity)) {
+            result.push_back(entity);
+        }
+    }
+    return result;
+}
+
+template<typename... Cs>
+static auto view_all(PlannedWorld &world) -> std::vector<size_t>
+{
+    std::vector<size_t> result;
+    for (auto entity : world.view<Cs...>()) {
+        result.push_back(entity);
+    }
+    return result;
+}
+
+// a view is driven by the column of its rarest component when at most a quarter of the slots have it,
+// and walks the same entities in the same order as testing every slot
+static void test_query_planner()
+{
+    PlannedWorld world;
+    for (size_t i = 0; i < 2000; i++) {
+        auto entity = world.new_entity();
+        world.add<Position>(entity, Position {static_cast<float>(i), 0, 0});
+        if (i % 2 == 0) {
+            world.add<Level>(entity, Level {static_cast<int>(i)});
+        }
+        if (i % 50 == 0) {
+            world.add<C>(entity, C {});
+        }
+    }
+    for (size_t entity = 0; entity < 2000; entity += 7) {
+        world.delete_entity(entity);
+    }
+    auto check_views = [&world]() {
+        CHECK((view_all<Position>(world) == scan_all<Position>(world)));
+        CHECK((view_all<Position, Level>(world) == scan_all<Position, Level>(world)));
+        CHECK((view_all<Position, C>(world) == scan_all<Position, C>(world)));
+        CHECK((view_all<Level, C, Position>(world) == scan_all<Level, C, Position>(world)));
+    };
+
+    QueryPlan half = world.plan<Position, Level>();
+    CHECK(half.kind == QueryPlan::Kind::Scan && half.driver == "Level");
+    CHECK(half.candidates == world.count<Level>() && half.range == 2000);
+    QueryPlan rare = world.plan<Level, C, Position>();
+    CHECK(rare.kind == QueryPlan::Kind::Column && rare.driver == "C");
+    CHECK(rare.candidates == world.count<C>() && rare.candidates == 34);
+    check_views();
+
+    // C on every entity: Level becomes the rarest
+    for (auto entity : world) {
+        world.add<C>(entity, C {});
+    }
+    CHECK((world.plan<Level, C, Position>().driver == "Level"));
+    check_views();
+    // a quarter of the slots is the limit
+    for (size_t entity = 0; entity < 2000; entity++) {
+        if (world.has<Level>(entity) && entity % 4 != 0) {
+            world.remove<Level>(entity);
+        }
+    }
+    CHECK(world.count<Level>() * 4 <= 2000);
+    CHECK((world.plan<Position, Level>().kind == QueryPlan::Kind::Column));
+    check_views();
+    // group members are packed out of id order, the view still walks the ids in order
+    auto group = world.group<Position, C>();
+    CHECK(group.size() == world.count<C>());
+    check_views();
+}
+
+// cannot be default constructed, counts its live instances
+struct Named {
+    static inline int alive = 0;
+    std::string name;
+
+    explicit Named(std::string name):
+        name(std::move(name))
+    {
+        alive++;
+    }
+    Named(const Named &other):
+        name(other.name)
+    {
+        alive++;
+    }
+    auto operator=(const Named &) -> Named & = default;
+    ~Named() { alive--; }
+};
+
+// add and emplace build the components without a default constructor, remove and delete destroy them
+static void test_non_default_constructible()
+{
+    {
+        World<Position, Named> world;
+        auto a = world.new_entity();
+        auto b = world.new_entity();
+        auto c = world.new_entity();
+        world.add<Named>(a, Named {"a"});
+        world.emplace<Named>(b, "b");
+        world.emplace<Named>(b, "rebuilt");
+        world.add<Position>(c, Position {1, 2, 3});
+        CHECK(Named::alive == 2);
+        CHECK(std::get<0>(world.get<Named>(b).value()).name == "rebuilt");
+        CHECK(!world.has<Named>(c));
+        world.remove<Named>(a);
+        CHECK(Named::alive == 1);
+        world.delete_entity(b);
+        CHECK(Named::alive == 0);
+        std::vector<Entity> ids = {a, c, world.new_entity()};
+        std::vector<Named> names = {Named {"x"}, Named {"y"}, Named {"z"}};
+        world.add_bulk<Named>(ids, names);
+        CHECK(Named::alive == 6);
+        CHECK(world.count<Named>() == 3);
+        CHECK(std::get<0>(world.get<Named>(ids[2]).value()).name == "z");
+        // growing the tables moves the slots
+        for (int i = 0; i < 100; i++) {
+            world.emplace<Named>(world.new_entity(), "grown");
+        }
+        CHECK(Named::alive == 106);
+        CHECK(std::get<0>(world.get<Named>(c).value()).name == "y");
+        // the slots are optionals, bigger than the component
+        WorldStats stats = world.stats();
+        CHECK(stats.growth_events != 0);
+        CHECK(stats.growth_bytes_copied >= 8 * (sizeof(Position) + sizeof(std::optional<Named>)));
+        CHECK(stats.components[1].capacity_bytes == stats.capacity * sizeof(std::optional<Named>));
+    }
+    CHECK(Named::alive == 0);
+}
+
+// add_bulk leaves the world as adding the components one by one does, runs, gaps and replacements mixed
+static void test_add_bulk()
+{
+    World<Position, Level> bulk;
+    World<Position, Level> single;
+    for (int i = 0; i < 300; i++) {
+        bulk.new_entity();
+        single.new_entity();
+        if (i % 10 == 0) {
+            bulk.add<Position>(static_cast<size_t>(i), Position {-1, -1, -1});
+            single.add<Position>(static_cast<size_t>(i), Position {-1, -1, -1});
+        }
+    }
+    std::vector<Entity> ids;
+    std::vector<Position> positions;
+    for (size_t i = 0; i < 300; i++) {
+        // runs of 1 to 7 consecutive ids separated by gaps of 1 to 3
+        if (i % 11 < 1 + i % 7) {
+            ids.push_back(i);
+            positions.push_back(Position {static_cast<float>(i), 0, 1});
+        }
+    }
+    bulk.add_bulk<Position>(ids, positions);
+    for (size_t i = 0; i < ids.size(); i++) {
+        single.add<Position>(ids[i], Position {positions[i]});
+    }
+    CHECK(bulk.count<Position>() == single.count<Position>());
+    for (size_t entity = 0; entity < 300; entity++) {
+        CHECK(bulk.has<Position>(entity) == single.has<Position>(entity));
+        if (single.has<Position>(entity)) {
+            auto [expected] = single.get<Position>(entity).value();
+            auto [pos] = bulk.get<Position>(entity).value();
+            CHECK(pos.x == expected.x && pos.y == expected.y && pos.z == expected.z);
+        }
+    }
+    std::vector<size_t> bulk_view;
+    std::vector<size_t> single_view;
+    for (auto entity : bulk.view<Position>()) {
+        bulk_view.push_back(entity);
+    }
+    for (auto entity : single.view<Position>()) {
+        single_view.push_back(entity);
+    }
+    CHECK(bulk_view == single_view);
+}
+
+// (tick, task) in resume order
+using WakeLog = std::vector<std::pair<uint64_t, int>>;
+
+// waits until start, then until deadline, and logs the tick it is resumed on
+static auto wake_at(Scheduler &scheduler, uint64_t start, uint64_t deadline, int id, WakeLog &log) -> Task
+{
+    if (start > 0) {
+        co_await scheduler.wait(static_cast<float>(start));
+    }
+    co_await scheduler.wait(static_cast<float>(deadline - scheduler.now()));
+    log.emplace_back(scheduler.now(), id);
+}
+
+static auto count_ticks(Scheduler &scheduler, int &ticks, int limit) -> Task
+{
+    while (ticks < limit) {
+        co_await scheduler.next_tick();
+        ticks++;
+    }
+}
+
+struct DestroyGuard {
+    int &destroyed;
+
+    ~DestroyGuard() { destroyed++; }
+};
+
+static auto sleep(Scheduler &scheduler, float seconds, int &destroyed) -> Task
+{
+    DestroyGuard guard {destroyed};
+    co_await scheduler.wait(seconds);
+}
+
+// every task resumes exactly on its deadline, on both sides of the wheel and from the heap
+static void test_scheduler_deadlines()
+{
+    Scheduler scheduler(1.0f);
+    WakeLog log;
+    std::vector<uint64_t> deadlines = {1, 2, 3, 255, 256, 257, 511, 512, 513, 1000};
+    for (size_t i = 0; i < deadlines.size(); i++) {
+        scheduler.spawn(wake_at(scheduler, 0, deadlines[i], static_cast<int>(i), log));
+    }
+    CHECK(scheduler.size() == deadlines.size());
+    while (scheduler.now() < 1100) {
+        scheduler.advance();
+    }
+    CHECK(scheduler.size() == 0);
+    CHECK(log.size() == deadlines.size());
+    for (auto [tick, id] : log) {
+        CHECK(tick == deadlines[static_cast<size_t>(id)]);
+    }
+    CHECK(std::is_sorted(log.begin(), log.end()));
+}
+
+// tasks due on the same tick resume in the order they suspended, whether they waited in the heap
+// (suspended 256 ticks or more before) or went straight to the wheel
+static void test_scheduler_ties()
+{
+    Scheduler scheduler(1.0f);
+    WakeLog log;
+    // by id: the tick of the last suspension, all of them due at 600
+    std::vector<uint64_t> starts = {0, 100, 400, 599, 0, 344};
+    for (size_t i = 0; i < starts.size(); i++) {
+        scheduler.spawn(wake_at(scheduler, starts[i], 600, static_cast<int>(i), log));
+    }
+    while (scheduler.now() < 600) {
+        scheduler.advance();
+    }
+    CHECK((log == WakeLog {{600, 0}, {600, 4}, {600, 1}, {600, 5}, {600, 2}, {600, 3}}));
+}
+
+// a task runs until its first wait when spawned, then once per advance(); finished tasks leave the
+// scheduler and the ones still waiting are destroyed with it
+static void test_scheduler_resume()
+{
+    int destroyed = 0;
+    {
+        Scheduler scheduler(0.5f);
+        int ticks = 0;
+        scheduler.spawn(count_ticks(scheduler, ticks, 3));
+        CHECK(ticks == 0 && scheduler.size() == 1);
+        scheduler.advance();
+        CHECK(ticks == 1);
+        scheduler.advance();
+        scheduler.advance();
+        CHECK(ticks == 3 && scheduler.size() == 0);
+        scheduler.advance();
+        CHECK(ticks == 3);
+        // 0.7 s is 2 ticks, 1000 s waits in the heap
+        scheduler.spawn(sleep(scheduler, 0.7f, destroyed));
+        scheduler.spawn(sleep(scheduler, 1000, destroyed));
+        scheduler.advance();
+        CHECK(destroyed == 0);
+        scheduler.advance();
+        CHECK(destroyed == 1 && scheduler.size() == 1);
+    }
+    CHECK(destroyed == 2);
+}
+
+struct Hit {
+    size_t entity;
+    int damage;
+
+    auto operator==(const Hit &) const -> bool = default;
+};
+
+// writers merge their events when flushed or destroyed, in that order, and every event stays
+// readable until the frame boundary
+static void test_event_writers()
+{
+    World<Position, Level> world;
+    CHECK(world.events<Hit>().empty());
+    world.emit(Hit {0, 1});
+    {
+        auto first = world.event_writer<Hit>();
+        auto second = world.event_writer<Hit>();
+        first.emit(Hit {1, 10});
+        first.emit(Hit {1, 11});
+        second.emit(Hit {2, 20});
+        CHECK(world.events<Hit>().size() == 1);
+        second.flush();
+        second.emit(Hit {2, 21});
+        // second is destroyed first
+    }
+    std::vector<Hit> expected = {{0, 1}, {2, 20}, {2, 21}, {1, 10}, {1, 11}};
+    auto merged = world.events<Hit>();
+    CHECK(std::equal(expected.begin(), expected.end(), merged.begin(), merged.end()));
+    world.clear_events();
+    CHECK(world.events<Hit>().empty());
+    world.emit(Hit {3, 30});
+    CHECK(world.events<Hit>().size() == 1);
+    world.clear_events();
+
+    // every flush lands in one piece, and the events of a thread keep their order
+    constexpr int threads = 4;
+    constexpr int per_thread = 1000;
+    constexpr int per_flush = 100;
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&world, t]() {
+            auto writer = world.event_writer<Hit>();
+            for (int i = 0; i < per_thread; i++) {
+                writer.emit(Hit {t, i});
+                if (i % per_flush == per_flush - 1) {
+                    writer.flush();
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    auto hits = world.events<Hit>();
+    CHECK(hits.size() == threads * per_thread);
+    std::array<int, threads> next {};
+    for (size_t i = 0; i < hits.size(); i++) {
+        CHECK(hits[i].entity == hits[i - i % per_flush].entity);
+        CHECK(hits[i].damage == next[hits[i].entity]++);
+    }
+}
+
+struct Hot {
+    float value;
+};
+
+struct Cold {
+    int value;
+};
+
+template<>
+struct component_traits<Hot> {
+    static constexpr Placement placement = Placement::Hot;
+};
+
+template<>
+struct component_traits<Cold> {
+    static constexpr Placement placement = Placement::Cold;
+};
+
+// the placement of every table shows in stats(), hot tables start on a cache line, and profiled
+// builds report the accesses per tick
+static void test_table_placement()
+{
+    World<Position, Hot, Cold> world;
+    for (int i = 0; i < 1000; i++) {
+        auto entity = world.new_entity();
+        world.add<Hot>(entity, Hot {static_cast<float>(i)});
+        world.add<Cold>(entity, Cold {i});
+    }
+    WorldStats stats = world.stats();
+    CHECK(stats.components[0].placement == Placement::Default);
+    CHECK(stats.components[1].placement == Placement::Hot);
+    CHECK(stats.components[2].placement == Placement::Cold);
+    auto &hot = std::get<0>(world.get<Hot>(0).value());
+    CHECK(reinterpret_cast<uintptr_t>(&hot) % 64 == 0);
+    std::ostringstream printed;
+    printed << stats;
+    CHECK(printed.str().find(", hot") != std::string::npos);
+    CHECK(printed.str().find(", cold") != std::string::npos);
+#ifdef BECS_PROFILE
+    world.report_access();
+    for (int tick = 0; tick < 2; tick++) {
+        for (size_t entity = 0; entity < 3; entity++) {
+            static_cast<void>(world.get<Hot>(entity));
+        }
+        world.add<Cold>(0, Cold {tick});
+        world.report_access();
+    }
+    stats = world.stats();
+    CHECK(stats.components[1].reads_per_tick > 0 && stats.components[2].writes_per_tick > 0);
+#endif
+}
+
+// counts the allocations made while the fixed capacity world runs, it must not make any
+static std::atomic<size_t> allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    if (void *data = std::malloc(size != 0 ? size : 1)) {
+        return data;
+    }
+    std::abort();
+}
+
+void operator delete(void *data) noexcept
+{
+    std::free(data);
+}
+
+void operator delete(void *data, size_t) noexcept
+{
+    std::free(data);
+}
+
+using Arena = StaticWorld<1024, Position, Level>;
+// the status, both tables and a bit column per component, all inside the world object
+static_assert(Arena::footprint(1024) == 1024 * (1 + sizeof(Position) + sizeof(Level)) + 2 * (1024 / 64) * 8);
+static_assert(Arena::fixed_capacity && Arena::max_capacity == 1024);
+
+// a full fixed capacity world refuses new entities, reuses the freed ids and never allocates once built
+static void test_static_world()
+{
+    static Arena arena;
+    CHECK(arena.capacity() == 1024);
+    size_t before = allocations;
+    for (int i = 0; i < 1024; i++) {
+        auto entity = arena.try_new_entity();
+        CHECK(entity.has_value());
+        arena.add<Level>(entity.value(), Level {i});
+        if (i % 2 == 0) {
+            arena.emplace<Position>(entity.value(), static_cast<float>(i), 0.0f, 0.0f);
+        }
+    }
+    CHECK(!arena.try_new_entity().has_value());
+    CHECK(arena.size() == 1024);
+    arena.delete_entity(100);
+    arena.delete_entity(7);
+    CHECK(arena.try_new_entity() == std::optional<size_t>(7));
+    CHECK(arena.try_new_entity() == std::optional<size_t>(100));
+    CHECK(!arena.try_new_entity().has_value());
+    int sum = 0;
+    for (auto entity : arena.view<Position, Level>()) {
+        auto [pos, level] = arena.get<Position, Level>(entity).value();
+        CHECK(static_cast<int>(pos.x) == level.value);
+        sum++;
+    }
+    CHECK(sum == 511);
+    CHECK(allocations == before);
+}
+
+// get_many and each_many find the same rows as get, whatever the prefetch distance
+static void test_gather()
+{
+    World<Position, Level> world;
+    for (int i = 0; i < 500; i++) {
+        auto entity = world.new_entity();
+        world.add<Position>(entity, Position {static_cast<float>(i), 0, 0});
+        if (i % 3 != 0) {
+            world.add<Level>(entity, Level {i});
+        }
+    }
+    // scattered ids, some twice, some lacking Level
+    std::vector<Entity> ids;
+    for (size_t i = 0; i < 700; i++) {
+        ids.push_back(i * 7919 % 500);
+    }
+    for (size_t distance : {0, 1, 8, 1000}) {
+        auto rows = world.get_many<Position, Level>(ids, distance);
+        CHECK(rows.size() == ids.size());
+        std::vector<Entity> expected;
+        for (size_t i = 0; i < ids.size(); i++) {
+            auto [pos, level] = rows[i];
+            if (auto opt = world.get<Position, Level>(ids[i]); opt.has_value()) {
+                CHECK(pos == &std::get<0>(opt.value()) && level == &std::get<1>(opt.value()));
+                expected.push_back(ids[i]);
+            } else {
+                CHECK(pos == nullptr && level == nullptr);
+            }
+        }
+        std::vector<Entity> visited;
+        world.each_many<Position, Level>(
+            ids,
+            [&](size_t entity, Position &pos, Level &level) {
+                CHECK(static_cast<int>(pos.x) == level.value);
+                visited.push_back(entity);
+            },
+            distance
+        );
+        CHECK(visited == expected);
+    }
+    // out shorter than the ids: only its rows are written
+    std::vector<std::tuple<Level *>> out(10);
+    world.get_many<Level>(ids, std::span<std::tuple<Level *>>(out));
+    auto last = world.get<Level>(ids[9]);
+    CHECK(std::get<0>(out[9]) == (last.has_value() ? &std::get<0>(last.value()) : nullptr));
+}
+
+// add_bulk notifies its new components in a single batch, replaced components are not added again,
+// remove and delete observers see the entities while they still have their components
+static void test_observer_batches()
+{
+    World<Position, Level> world;
+    std::vector<std::vector<size_t>> batches;
+    world.on_add<Level>([&batches](std::span<const size_t> entities) {
+        batches.emplace_back(entities.begin(), entities.end());
+    });
+    int removed_sum = 0;
+    auto removing = world.on_remove<Level>([&world, &removed_sum](std::span<const size_t> entities) {
+        for (size_t entity : entities) {
+            removed_sum += std::get<0>(world.get<Level>(entity).value()).value;
+        }
+    });
+    std::vector<size_t> deleted;
+    world.on_delete([&deleted](std::span<const size_t> entities) {
+        deleted.insert(deleted.end(), entities.begin(), entities.end());
+    });
+    std::vector<size_t> ids;
+    for (int i = 0; i < 8; i++) {
+        ids.push_back(world.new_entity());
+    }
+    world.add<Level>(ids[2], Level {100});
+    CHECK(batches.size() == 1);
+    std::vector<Level> levels {{0}, {1}, {2}, {3}, {4}, {5}, {6}, {7}};
+    world.add_bulk<Level>(ids, levels);
+    CHECK(batches.size() == 2);
+    CHECK(batches[1].size() == 7);
+    CHECK(std::find(batches[1].begin(), batches[1].end(), ids[2]) == batches[1].end());
+    CHECK(std::get<0>(world.get<Level>(ids[2]).value()).value == 2);
+    world.remove<Level>(ids[5]);
+    CHECK(removed_sum == 5);
+    world.delete_entity(ids[6]);
+    CHECK(removed_sum == 11);
+    CHECK(deleted == std::vector<size_t> {ids[6]});
+    world.unobserve(removing);
+    world.delete_entity(ids[7]);
+    CHECK(removed_sum == 11);
+    CHECK(deleted.size() == 2);
+}
+
+// the links follow their entities through sort_by, deleted entities leave the hierarchy
+static void test_hierarchy_remap()
+{
+    World<Position, Level> world;
+    Hierarchy hierarchy;
+    hierarchy.track(world);
+    // entity i has level i and is laid out in reverse, the parent of level i is level i / 3
+    for (int i = 0; i < 60; i++) {
+        auto entity = world.new_entity();
+        world.add<Level>(entity, Level {i});
+        world.add<Position>(entity, Position {static_cast<float>(60 - i), 0, 0});
+        if (i > 0) {
+            hierarchy.set_parent(entity, static_cast<size_t>(i / 3));
+        }
+    }
+    auto level_of = [&world](size_t entity) { return std::get<0>(world.get<Level>(entity).value()).value; };
+    auto check_links = [&](size_t links) {
+        CHECK(hierarchy.size() == links);
+        size_t seen = 0;
+        std::vector<bool> reached(61, false);
+        reached[0] = true;
+        hierarchy.each([&](size_t parent, size_t child) {
+            CHECK(level_of(parent) == level_of(child) / 3);
+            // parents come before their children
+            CHECK(reached[level_of(parent)]);
+            reached[level_of(child)] = true;
+            seen++;
+        });
+        CHECK(seen == links);
+    };
+    auto key = [](const Position &pos) { return pos.x; };
+    check_links(59);
+    // remapping renames the packed links, only a change of the links themselves rebuilds them
+    for (int call = 0; call < 10; call++) {
+        hierarchy.remap(world.sort_by<Position>(key, 5));
+        CHECK(!hierarchy.needs_rebuild());
+        check_links(59);
+    }
+    hierarchy.remap(world.sort_by<Position>(key));
+    CHECK(!hierarchy.needs_rebuild());
+    check_links(59);
+    CHECK(level_of(0) == 59);
+    // level 1 is the parent of levels 3, 4 and 5, they become roots
+    size_t removed = 0;
+    for (auto entity : world) {
+        if (level_of(entity) == 1) {
+            removed = entity;
+        }
+    }
+    world.delete_entity(removed);
+    CHECK(hierarchy.needs_rebuild());
+    CHECK(hierarchy.size() == 55);
+    CHECK(!hierarchy.parent(removed).has_value());
+}
+
+struct Heading {
+    float angle;
+};
+
+template<>
+struct component_traits<Heading> {
+    static constexpr bool buffered = true;
+};
+
+// previous<C> holds the values of the last store_previous(): writes of the tick never reach it, it
+// follows its entity through sort_by and never leaks into an entity reusing a deleted id
+static void test_previous_values()
+{
+    World<Position, Heading> world;
+    auto current = [&world](size_t entity) -> float & {
+        return std::get<0>(world.get<Heading>(entity).value()).angle;
+    };
+    auto previous = [&world](size_t entity) {
+        return std::get<0>(world.previous<Heading>(entity).value()).angle;
+    };
+    // positions in reverse order, for the sort
+    for (int i = 0; i < 8; i++) {
+        auto entity = world.new_entity();
+        world.add<Heading>(entity, Heading {static_cast<float>(i)});
+        world.add<Position>(entity, Position {static_cast<float>(8 - i), 0, 0});
+    }
+    // added during the tick: no previous value yet, it starts from the added one
+    CHECK(previous(3) == 3);
+    world.store_previous();
+    for (size_t entity = 0; entity < 8; entity++) {
+        current(entity) += 100;
+        CHECK(previous(entity) == static_cast<float>(entity));
+    }
+    // replacing a component is a write, the previous value stays the one of the last tick
+    world.add<Heading>(2, Heading {-1});
+    CHECK(previous(2) == 2);
+    world.store_previous();
+    CHECK(previous(2) == -1 && previous(5) == 105);
+
+    for (size_t entity = 0; entity < 8; entity++) {
+        current(entity) += 1000;
+    }
+    auto remaps = world.sort_by<Position>([](const Position &pos) { return pos.x; });
+    CHECK(!remaps.empty());
+    for (size_t entity = 0; entity < 8; entity++) {
+        CHECK(current(entity) == previous(entity) + 1000);
+    }
+    CHECK(std::get<0>(world.get<Position>(0).value()).x == 1);
+
+    world.delete_entity(4);
+    CHECK(!world.previous<Heading>(4).has_value());
+    auto reused = world.new_entity();
+    CHECK(reused == 4);
+    CHECK(!world.previous<Heading>(reused).has_value());
+    world.add<Heading>(reused, Heading {7});
+    CHECK(previous(reused) == 7);
+}
+
+// cells out of range leave the world as blobs and come back with the same components, one batch per cell
+// entities with a component the streamer does not save never leave
+static void test_cell_streaming()
+{
+    World<Position, Level, int> world;
+    CellStreamer<Position, Level> streamer(10, 1);
+    // a 20x20 grid 5 apart, 4 entities per cell, the ones on even columns have a level, z is the grid index
+    for (int i = 0; i < 400; i++) {
+        auto entity = world.new_entity();
+        float x = static_cast<float>(i % 20) * 5;
+        float y = static_cast<float>(i / 20) * 5;
+        world.add<Position>(entity, Position {x, y, static_cast<float>(i)});
+        if (i % 2 == 0) {
+            world.add<Level>(entity, Level {i});
+        }
+    }
+    auto pinned = world.new_entity();
+    world.add<Position>(pinned, Position {95, 95, -1});
+    world.add<int>(pinned, 7);
+    size_t batches = 0;
+    world.on_add<Position>([&batches](std::span<const size_t>) { batches++; });
+    auto check_resident = [&world](float min, float max) {
+        for (auto entity : world.view<Position>()) {
+            auto [pos] = world.get<Position>(entity).value();
+            if (pos.z < 0) {
+                CHECK(world.has<int>(entity));
+                continue;
+            }
+            CHECK(pos.x >= min && pos.x < max && pos.y >= min && pos.y < max);
+            int index = static_cast<int>(pos.z);
+            CHECK(pos.x == static_cast<float>(index % 20) * 5 && pos.y == static_cast<float>(index / 20) * 5);
+            auto level = world.get<Level>(entity);
+            CHECK(level.has_value() == (index % 2 == 0));
+            CHECK(!level.has_value() || std::get<0>(level.value()).value == index);
+        }
+    };
+
+    // around (5, 5) cells 0 and 1 stay on both axes, 16 entities
+    const Position corner[] = {{5, 5, 0}};
+    streamer.update(world, corner);
+    CHECK(world.size() == 16 + 1);
+    CHECK(streamer.stored_cells() == 96);
+    // count, then per component a one byte bitmap and the packed fields: 12 bytes per position, 4 per level
+    CHECK(streamer.stored_bytes() == 96 * (4 + 1 + 4 * 12 + 1 + 2 * 4));
+    check_resident(0, 20);
+
+    const Position opposite[] = {{95, 95, 0}};
+    streamer.update(world, opposite);
+    streamer.flush(world);
+    CHECK(batches == 4);
+    CHECK(world.size() == 16 + 1);
+    CHECK(streamer.stored_cells() == 96);
+    check_resident(80, 100);
+
+    std::vector<Position> everywhere;
+    for (int y = 0; y < 100; y += 30) {
+        for (int x = 0; x < 100; x += 30) {
+            everywhere.push_back(Position {static_cast<float>(x), static_cast<float>(y), 0});
+        }
+    }
+    streamer.update(world, everywhere);
+    streamer.flush(world);
+    CHECK(batches == 4 + 96);
+    CHECK(world.size() == 400 + 1);
+    CHECK(world.count<Level>() == 200);
+    CHECK(streamer.stored_cells() == 0);
+    CHECK(streamer.stored_bytes() == 0);
+    check_resident(0, 100);
+}
+
 int main()
 {
+    test_shard_migrations();
+    test_shard_rebalance();
+    test_group_views();
+    test_incremental_sort();
+    test_logger();
+#ifdef BECS_PROFILE
+    test_profiler_thread_exit();
+#endif
+    test_world_stats();
+    test_double_buffer();
+    test_input_mailbox();
+    test_replay_round_trip();
+    test_reflection();
+    test_mapped_reopen();
+    test_concurrent_commit();
+    test_query_planner();
+    test_non_default_constructible();
+    test_add_bulk();
+    test_scheduler_deadlines();
+    test_scheduler_ties();
+    test_scheduler_resume();
+    test_event_writers();
+    test_table_placement();
+    test_static_world();
+    test_gather();
+    test_observer_batches();
+    test_hierarchy_remap();
+    test_previous_values();
+    test_cell_streaming();
+
     World<int, Position, Level, D, E, F, G, H, std::unique_ptr<I>> world;
 
     // Add data to the world
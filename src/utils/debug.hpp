@@ -1,45 +1,98 @@
 
 #pragma once
 
+#include "reflect.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <iostream>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <type_traits>
 
 namespace dbg {
 
-// Helper to print a tuple (used for multiple member variables)
-template<std::size_t Index = 0, typename... Types>
-    requires(Index == sizeof...(Types))
-auto print_tuple(std::ostream &os, const std::tuple<Types...> &) -> std::ostream &
+// readable name of T, taken from the compiler generated signature (e.g. "CPosition")
+template<typename T>
+constexpr auto type_name() -> std::string_view
 {
-    return os;
+    std::string_view name = __PRETTY_FUNCTION__;
+    // gcc: "... [with T = CPosition; std::string_view = ...]", clang: "... [T = CPosition]"
+    auto start = name.find("T = ") + 4;
+    auto end = name.find_first_of(";]", start);
+    return name.substr(start, end - start);
 }
 
-template<std::size_t Index = 0, typename... Types>
-    requires(Index < sizeof...(Types))
-constexpr auto print_tuple(std::ostream &os, const std::tuple<Types...> &t) -> std::ostream &
+// string literal usable as a template argument
+template<size_t N>
+struct Literal {
+    std::array<char, N> chars {};
+
+    // NOLINTNEXTLINE(google-explicit-constructor) built from a literal at the call site
+    constexpr Literal(const char (&text)[N]) { std::copy_n(text, N, chars.begin()); }
+};
+
+// Prefix + "<A, B, ...>" null terminated and built at compile time, for names that must not allocate
+// (profiler zones and counters recorded from fixed capacity worlds)
+template<Literal Prefix, typename... Ts>
+inline constexpr auto type_list_label = []() {
+    constexpr size_t prefix = Prefix.chars.size() - 1;
+    constexpr size_t names = (size_t {0} + ... + type_name<Ts>().size());
+    constexpr size_t separators = sizeof...(Ts) == 0 ? 0 : 2 * (sizeof...(Ts) - 1);
+    std::array<char, prefix + names + separators + 3> label {};
+    auto out = std::copy_n(Prefix.chars.begin(), prefix, label.begin());
+    *out++ = '<';
+    bool first = true;
+    (
+        [&]() {
+            if (!first) {
+                *out++ = ',';
+                *out++ = ' ';
+            }
+            first = false;
+            out = std::copy(type_name<Ts>().begin(), type_name<Ts>().end(), out);
+        }(),
+        ...
+    );
+    *out = '>';
+    return label;
+}();
+
+// enums print as their underlying value, byte sized integers as numbers rather than characters
+template<typename T>
+auto print_value(std::ostream &os, const T &value) -> std::ostream &
 {
-    os << (Index != 0 ? ", " : "") << std::get<Index>(t);
-    return print_tuple<Index + 1>(os, t);
+    if constexpr (std::is_enum_v<T>) {
+        return os << +static_cast<std::underlying_type_t<T>>(value);
+    } else if constexpr (std::is_integral_v<T> && sizeof(T) == 1 && !std::is_same_v<T, bool>) {
+        return os << +value;
+    } else {
+        return os << value;
+    }
 }
 
-// Template function to generate the operator<< overload
-template<typename T, typename... Args>
-auto print(std::ostream &os, const T &obj, const std::string &className, const std::tuple<Args...> &args)
-    -> std::ostream &
+// "ClassName(field, field, ...)" from the reflected fields
+template<reflect::Reflected T>
+auto print(std::ostream &os, const T &obj, std::string_view className) -> std::ostream &
 {
-    os << className << "("; print_tuple(os, args) << ")";
-    return os;
+    os << className << "(";
+    bool first = true;
+    reflect::for_each_field<T>([&](const auto &field) {
+        os << (first ? "" : ", ");
+        print_value(os, field.get(obj));
+        first = false;
+    });
+    return os << ")";
 }
 
 } // namespace dbg
 
-// Macro to automatically generate the operator<< overload for a struct
+// Macro to reflect the fields of a struct and generate its operator<< overload
 #define DERIVE_DEBUG(ClassName, ...)                                        \
-    inline auto get_members() const { return std::tie(__VA_ARGS__); }       \
+    REFLECT(ClassName, __VA_ARGS__)                                         \
     friend std::ostream &operator<<(std::ostream &os, const ClassName &obj) \
     {                                                                       \
-        return dbg::print(os, obj, #ClassName, obj.get_members());          \
+        return dbg::print(os, obj, #ClassName);                             \
     }
-
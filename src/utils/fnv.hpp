@@ -0,0 +1,39 @@
+#pragma once
+
+// FNV-1a, 64 bits: stable across runs, builds and platforms of the same endianness, for the hashes
+// that get saved or compared between runs (replay state hashes, layout of the persistent tables)
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace fnv {
+
+class Hasher {
+private:
+    uint64_t hash = 14695981039346656037ULL;
+
+public:
+    inline void mix(const void *data, size_t size)
+    {
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    }
+
+    inline void mix(std::string_view text) { mix(text.data(), text.size()); }
+
+    // the object bytes, padding included: only for types without any
+    template<typename T>
+        requires std::is_trivially_copyable_v<T>
+    inline void mix_value(const T &value)
+    {
+        mix(&value, sizeof(T));
+    }
+
+    [[nodiscard]] inline auto value() const -> uint64_t { return hash; }
+};
+
+} // namespace fnv
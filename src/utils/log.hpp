@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+// Asynchronous logger for hot paths
+// LOG_DEBUG("Position: ", pos) copies its arguments as a binary record into a per-thread ring buffer,
+// formatting (operator<<, e.g. the one from DERIVE_DEBUG) and I/O happen later on a background thread.
+// Arguments must be trivially copyable, strings must be literals since only the pointer is copied.
+// Levels below BECS_LOG_LEVEL compile to nothing, arguments are not even evaluated.
+
+#ifndef BECS_LOG_LEVEL
+#ifdef DEBUG
+#define BECS_LOG_LEVEL 1 // Debug
+#else
+#define BECS_LOG_LEVEL 2 // Info
+#endif
+#endif
+
+// bytes per thread, must be a power of 2
+#ifndef BECS_LOG_BUFFER_SIZE
+#define BECS_LOG_BUFFER_SIZE (1 << 16)
+#endif
+
+namespace logging {
+
+enum class Level : uint8_t {
+    Trace,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off,
+};
+
+constexpr auto enabled(Level level) -> bool
+{
+    return static_cast<int>(level) >= BECS_LOG_LEVEL && level != Level::Off;
+}
+
+using formatter_t = void (*)(std::ostream &, const std::byte *);
+
+struct alignas(16) RecordHeader {
+    // nullptr for the padding record skipping the end of the buffer
+    formatter_t format;
+    uint32_t size;
+};
+
+// single producer (the owning thread), single consumer (the logger thread)
+class RingBuffer {
+public:
+    static constexpr size_t capacity = BECS_LOG_BUFFER_SIZE;
+    static_assert((capacity & (capacity - 1)) == 0, "BECS_LOG_BUFFER_SIZE must be a power of 2");
+
+private:
+    static constexpr size_t mask = capacity - 1;
+
+    std::unique_ptr<std::byte[]> data = std::make_unique<std::byte[]>(capacity);
+    alignas(64) std::atomic<size_t> head = 0; // written by the producer
+    alignas(64) std::atomic<size_t> tail = 0; // written by the consumer
+
+public:
+    std::atomic<bool> retired = false;
+
+    // size must be a multiple of sizeof(RecordHeader), returns false when the buffer is full
+    template<typename F>
+    inline auto try_write(uint32_t size, formatter_t format, F &&write_payload) -> bool
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t t = tail.load(std::memory_order_acquire);
+        size_t contiguous = capacity - (h & mask);
+        size_t padding = contiguous < size ? contiguous : 0;
+        if (h + padding + size - t > capacity) {
+            return false;
+        }
+        if (padding != 0) {
+            new (&data[h & mask]) RecordHeader {nullptr, static_cast<uint32_t>(padding)};
+            h += padding;
+        }
+        std::byte *record = &data[h & mask];
+        new (record) RecordHeader {format, size};
+        write_payload(record + sizeof(RecordHeader));
+        head.store(h + size, std::memory_order_release);
+        return true;
+    }
+
+    // formats every pending record into os, returns the number of records
+    inline auto drain(std::ostream &os) -> size_t
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+        size_t count = 0;
+        while (t != h) {
+            auto *header = std::launder(reinterpret_cast<RecordHeader *>(&data[t & mask]));
+            if (header->format != nullptr) {
+                header->format(os, reinterpret_cast<std::byte *>(header) + sizeof(RecordHeader));
+                count++;
+            }
+            t += header->size;
+        }
+        tail.store(t, std::memory_order_release);
+        return count;
+    }
+
+    [[nodiscard]] inline auto empty() const -> bool
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+class Logger {
+private:
+    // taken for every drain, so the rings only ever have one consumer at a time
+    std::mutex buffers_mutex;
+    std::vector<std::shared_ptr<RingBuffer>> buffers;
+    std::ostream *output = &std::cout;
+    std::atomic<bool> running = true;
+    std::atomic<uint64_t> dropped = 0;
+    std::thread thread;
+
+    inline auto drain_all() -> size_t
+    {
+        std::lock_guard lock(buffers_mutex);
+        size_t count = 0;
+        for (auto &buffer : buffers) {
+            count += buffer->drain(*output);
+        }
+        // buffers of exited threads are released once everything they hold has been written
+        std::erase_if(buffers, [](const auto &buffer) { return buffer->retired && buffer->empty(); });
+        if (uint64_t lost = dropped.exchange(0); lost != 0) {
+            *output << "[log] dropped " << lost << " records\n";
+        }
+        if (count != 0) {
+            output->flush();
+        }
+        return count;
+    }
+
+    inline void run()
+    {
+        while (running.load(std::memory_order_relaxed)) {
+            if (drain_all() == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        drain_all();
+    }
+
+    Logger():
+        thread([this]() { run(); })
+    {
+    }
+
+public:
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    ~Logger()
+    {
+        running = false;
+        thread.join();
+    }
+
+    static inline auto instance() -> Logger &
+    {
+        static Logger logger;
+        return logger;
+    }
+
+    inline auto register_buffer() -> std::shared_ptr<RingBuffer>
+    {
+        auto buffer = std::make_shared<RingBuffer>();
+        std::lock_guard lock(buffers_mutex);
+        buffers.push_back(buffer);
+        return buffer;
+    }
+
+    inline void count_drop() { dropped.fetch_add(1, std::memory_order_relaxed); }
+
+    // writes everything logged before the call, on the calling thread: it does not depend on the logger
+    // thread still running
+    inline void flush() { drain_all(); }
+
+    // the records drained from now on go to os, which must outlive the logger (or the next call)
+    inline void set_output(std::ostream &os)
+    {
+        std::lock_guard lock(buffers_mutex);
+        output->flush();
+        output = &os;
+    }
+};
+
+// the ring of the calling thread, registered on first use and handed back to the logger on thread exit
+inline auto thread_buffer() -> RingBuffer &
+{
+    struct Handle {
+        std::shared_ptr<RingBuffer> buffer = Logger::instance().register_buffer();
+        ~Handle() { buffer->retired = true; }
+    };
+    thread_local Handle handle;
+    return *handle.buffer;
+}
+
+template<typename Record>
+constexpr uint32_t record_size =
+    static_cast<uint32_t>((sizeof(RecordHeader) + sizeof(Record) + sizeof(RecordHeader) - 1) /
+                          sizeof(RecordHeader) * sizeof(RecordHeader));
+
+inline auto operator<<(std::ostream &os, Level level) -> std::ostream &
+{
+    switch (level) {
+    case Level::Warn:
+        return os << "[warn] ";
+    case Level::Error:
+        return os << "[error] ";
+    default:
+        return os;
+    }
+}
+
+template<typename Record>
+void format_record(std::ostream &os, const std::byte *payload)
+{
+    const auto &record = *std::launder(reinterpret_cast<const Record *>(payload));
+    std::apply([&os](const auto &...args) { (os << ... << args) << '\n'; }, record);
+}
+
+template<typename... Args>
+inline void write(Level level, const Args &...args)
+{
+    using record_t = std::tuple<Level, std::decay_t<const Args &>...>;
+    static_assert(
+        (std::is_trivially_copyable_v<std::decay_t<const Args &>> && ...),
+        "log arguments are copied as raw bytes and formatted later, they must be trivially copyable"
+    );
+    static_assert(alignof(record_t) <= alignof(RecordHeader));
+    static_assert(record_size<record_t> <= RingBuffer::capacity / 2);
+
+    bool written = thread_buffer().try_write(record_size<record_t>, &format_record<record_t>, [&](std::byte *p) {
+        new (p) record_t(level, args...);
+    });
+    if (!written) {
+        Logger::instance().count_drop();
+    }
+}
+
+inline void flush()
+{
+    Logger::instance().flush();
+}
+
+inline void set_output(std::ostream &os)
+{
+    Logger::instance().set_output(os);
+}
+
+} // namespace logging
+
+#define LOG(level, ...)                                            \
+    do {                                                           \
+        if constexpr (logging::enabled(logging::Level::level)) {   \
+            logging::write(logging::Level::level, __VA_ARGS__);    \
+        }                                                          \
+    } while (0)
+
+#define LOG_TRACE(...) LOG(Trace, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG(Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG(Info, __VA_ARGS__)
+#define LOG_WARN(...) LOG(Warn, __VA_ARGS__)
+#define LOG_ERROR(...) LOG(Error, __VA_ARGS__)
@@ -0,0 +1,394 @@
+#pragma once
+
+// Frame profiler
+// PROFILE_ZONE("name") records the duration of the enclosing scope, PROFILE_COUNTER("name", value) a value.
+// Events go into a lock-free per-thread ring, profiler::end_frame() moves them into rolling statistics
+// (and into the trace while capturing), profiler::write_chrome_trace() exports chrome://tracing JSON.
+// A thread's ring is allocated by its first event, PROFILE_THREAD() does it up front.
+// Everything compiles out unless BECS_PROFILE is defined (xmake f --profile=y).
+
+#ifdef BECS_PROFILE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace profiler {
+
+// raw timestamp, converted to nanoseconds only when exporting
+// an empty zone is two of these plus about 4 ns of bookkeeping: where a hypervisor traps rdtsc (20 ns
+// instead of 7) the timestamps are most of it, `xmake run bench --filter profiler/` measures both
+inline auto now() -> uint64_t
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+struct Event {
+    enum class Kind : uint8_t {
+        Zone,
+        Counter,
+    };
+
+    const char *name;
+    uint64_t start;
+    // end timestamp for zones, value for counters
+    uint64_t end;
+    Kind kind;
+};
+
+struct ZoneStats {
+    std::string_view name;
+    size_t samples;
+    double p50_us;
+    double p90_us;
+    double p99_us;
+    double max_us;
+};
+
+// single producer (the owning thread), single consumer (end_frame)
+class ThreadBuffer {
+public:
+    static constexpr size_t capacity = 1 << 16;
+
+private:
+    static constexpr size_t mask = capacity - 1;
+
+    std::unique_ptr<Event[]> events = std::make_unique<Event[]>(capacity);
+    alignas(64) std::atomic<size_t> head = 0;
+    // last tail seen by the producer, avoids touching the consumer's cache line on every push
+    size_t cached_tail = 0;
+    alignas(64) std::atomic<size_t> tail = 0;
+
+public:
+    const uint32_t tid;
+
+    explicit ThreadBuffer(uint32_t tid):
+        tid(tid)
+    {
+    }
+
+    inline void push(const Event &event)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - cached_tail == capacity) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h - cached_tail == capacity) {
+                return; // full, end_frame() has not been called for a while
+            }
+        }
+        events[h & mask] = event;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    template<typename F>
+    inline void drain(F &&fn)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+        for (; t != h; t++) {
+            fn(events[t & mask]);
+        }
+        tail.store(t, std::memory_order_release);
+    }
+};
+
+class Profiler {
+public:
+    // durations kept per zone for the rolling percentiles
+    static constexpr size_t window = 512;
+    // trace events kept while capturing, older ones are dropped first
+    static constexpr size_t max_trace_events = 1 << 20;
+
+private:
+    struct TraceEvent {
+        Event event;
+        uint32_t tid;
+    };
+
+    struct Window {
+        std::vector<uint64_t> durations;
+        size_t next = 0;
+    };
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    // buffers of the threads that exited, drained and handed to the next threads (which keep their tid)
+    std::vector<ThreadBuffer *> free_buffers;
+    std::map<std::string_view, Window> windows;
+    std::deque<TraceEvent> trace;
+    bool capturing = false;
+
+    uint64_t origin_ticks = now();
+    std::chrono::steady_clock::time_point origin_time = std::chrono::steady_clock::now();
+
+    // nanoseconds per tick, measured over the whole run
+    inline auto tick_ns() -> double
+    {
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - origin_time);
+        uint64_t ticks = now() - origin_ticks;
+        return ticks == 0 ? 1.0 : elapsed.count() / static_cast<double>(ticks);
+    }
+
+    // the mutex must be held
+    inline void collect(ThreadBuffer &buffer)
+    {
+        buffer.drain([&](const Event &event) {
+            if (event.kind == Event::Kind::Zone) {
+                auto &win = windows[event.name];
+                if (win.durations.size() < window) {
+                    win.durations.push_back(event.end - event.start);
+                } else {
+                    win.durations[win.next] = event.end - event.start;
+                    win.next = (win.next + 1) % window;
+                }
+            }
+            if (capturing) {
+                if (trace.size() == max_trace_events) {
+                    trace.pop_front();
+                }
+                trace.push_back({event, buffer.tid});
+            }
+        });
+    }
+
+    static inline void write_escaped(std::ostream &os, std::string_view text)
+    {
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                os << '\\';
+            }
+            os << c;
+        }
+    }
+
+public:
+    static inline auto instance() -> Profiler &
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    inline auto acquire_buffer() -> ThreadBuffer *
+    {
+        std::lock_guard lock(mutex);
+        if (!free_buffers.empty()) {
+            ThreadBuffer *buffer = free_buffers.back();
+            free_buffers.pop_back();
+            return buffer;
+        }
+        buffers.push_back(std::make_unique<ThreadBuffer>(static_cast<uint32_t>(buffers.size())));
+        return buffers.back().get();
+    }
+
+    // at most the number of threads that recorded events at the same time
+    [[nodiscard]] inline auto buffer_count() -> size_t
+    {
+        std::lock_guard lock(mutex);
+        return buffers.size();
+    }
+
+    // the owning thread is exiting, its last events are collected right away
+    inline void release_buffer(ThreadBuffer *buffer)
+    {
+        std::lock_guard lock(mutex);
+        collect(*buffer);
+        free_buffers.push_back(buffer);
+    }
+
+    inline void set_capture(bool enabled)
+    {
+        std::lock_guard lock(mutex);
+        capturing = enabled;
+    }
+
+    // collects the events recorded since the last call, to be called once per frame
+    inline void end_frame()
+    {
+        std::lock_guard lock(mutex);
+        for (auto &buffer : buffers) {
+            collect(*buffer);
+        }
+    }
+
+    // p50/p90/p99/max over the last `window` samples of every zone
+    inline auto statistics() -> std::vector<ZoneStats>
+    {
+        std::lock_guard lock(mutex);
+        double to_us = tick_ns() / 1000.0;
+        std::vector<ZoneStats> result;
+        std::vector<uint64_t> sorted;
+        for (const auto &[name, win] : windows) {
+            sorted = win.durations;
+            std::sort(sorted.begin(), sorted.end());
+            auto at = [&](double q) {
+                return static_cast<double>(sorted[static_cast<size_t>(q * static_cast<double>(sorted.size() - 1))]) *
+                       to_us;
+            };
+            result.push_back({name, sorted.size(), at(0.5), at(0.9), at(0.99), at(1.0)});
+        }
+        return result;
+    }
+
+    inline void print_statistics(std::ostream &os)
+    {
+        for (const auto &stats : statistics()) {
+            os << stats.name << ": p50 " << stats.p50_us << "us, p90 " << stats.p90_us << "us, p99 "
+               << stats.p99_us << "us, max " << stats.max_us << "us (" << stats.samples << " samples)\n";
+        }
+    }
+
+    // chrome://tracing or https://ui.perfetto.dev trace_event format
+    inline void write_chrome_trace(std::ostream &os)
+    {
+        std::lock_guard lock(mutex);
+        double to_us = tick_ns() / 1000.0;
+        auto timestamp = [&](uint64_t ticks) {
+            return static_cast<double>(static_cast<int64_t>(ticks - origin_ticks)) * to_us;
+        };
+        os << "{\"traceEvents\":[\n";
+        bool first = true;
+        for (const auto &[event, tid] : trace) {
+            os << (first ? "" : ",\n") << "{\"name\":\"";
+            write_escaped(os, event.name);
+            if (event.kind == Event::Kind::Zone) {
+                os << "\",\"ph\":\"X\",\"ts\":" << timestamp(event.start)
+                   << ",\"dur\":" << static_cast<double>(event.end - event.start) * to_us;
+            } else {
+                os << "\",\"ph\":\"C\",\"ts\":" << timestamp(event.start) << ",\"args\":{\"value\":" << event.end
+                   << "}";
+            }
+            os << ",\"pid\":0,\"tid\":" << tid << "}";
+            first = false;
+        }
+        os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+};
+
+// hands the buffer of a thread back to the profiler when the thread exits
+class ThreadRegistration {
+private:
+    ThreadBuffer *&slot;
+
+public:
+    explicit ThreadRegistration(ThreadBuffer *&slot):
+        slot(slot)
+    {
+        slot = Profiler::instance().acquire_buffer();
+    }
+
+    ThreadRegistration(const ThreadRegistration &) = delete;
+    ThreadRegistration &operator=(const ThreadRegistration &) = delete;
+
+    ~ThreadRegistration()
+    {
+        Profiler::instance().release_buffer(slot);
+        slot = nullptr;
+    }
+};
+
+// the profiler owns the buffers, the raw pointer keeps the hot path free of thread_local init guards
+inline auto thread_buffer() -> ThreadBuffer &
+{
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (buffer == nullptr) [[unlikely]] {
+        thread_local ThreadRegistration registration(buffer);
+        if (buffer == nullptr) {
+            // recorded by a thread_local destructor after the release, that buffer is never recycled
+            buffer = Profiler::instance().acquire_buffer();
+        }
+    }
+    return *buffer;
+}
+
+// for threads that must not allocate once running
+inline void register_thread()
+{
+    static_cast<void>(thread_buffer());
+}
+
+// name must outlive the profiler (literal, __func__ or a static string)
+class ScopedZone {
+private:
+    const char *name;
+    uint64_t start;
+
+public:
+    explicit ScopedZone(const char *name):
+        name(name),
+        start(now())
+    {
+    }
+
+    ScopedZone(const ScopedZone &) = delete;
+    ScopedZone &operator=(const ScopedZone &) = delete;
+
+    ~ScopedZone() { thread_buffer().push({name, start, now(), Event::Kind::Zone}); }
+};
+
+inline void counter(const char *name, uint64_t value)
+{
+    thread_buffer().push({name, now(), value, Event::Kind::Counter});
+}
+
+inline void end_frame()
+{
+    Profiler::instance().end_frame();
+}
+
+inline void set_capture(bool enabled)
+{
+    Profiler::instance().set_capture(enabled);
+}
+
+inline void write_chrome_trace(std::ostream &os)
+{
+    Profiler::instance().write_chrome_trace(os);
+}
+
+inline void print_statistics(std::ostream &os)
+{
+    Profiler::instance().print_statistics(os);
+}
+
+} // namespace profiler
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) const profiler::ScopedZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_COUNTER(name, value) profiler::counter(name, static_cast<uint64_t>(value))
+#define PROFILE_FRAME() profiler::end_frame()
+#define PROFILE_THREAD() profiler::register_thread()
+
+#else
+
+#define PROFILE_ZONE(name) static_cast<void>(0)
+#define PROFILE_COUNTER(name, value) static_cast<void>(0)
+#define PROFILE_FRAME() static_cast<void>(0)
+#define PROFILE_THREAD() static_cast<void>(0)
+
+#endif
+
+// runs a system inside a zone named after it, e.g. PROFILE_SYSTEM(Sgravity_update, world, dt);
+#define PROFILE_SYSTEM(system, ...) \
+    do {                            \
+        PROFILE_ZONE(#system);      \
+        system(__VA_ARGS__);        \
+    } while (0)
@@ -0,0 +1,82 @@
+#pragma once
+
+// Compile-time field reflection
+// REFLECT(ClassName, fields...) inside a struct gives it a constexpr field list: name, member pointer,
+// offset and size of every field. Everything here is resolved at compile time, code generated from it
+// (printing, hashing, serialization, ...) is the same as the hand-written field by field version.
+
+#include <cstddef>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace reflect {
+
+template<typename Class, typename T>
+struct Field {
+    using class_type = Class;
+    using type = T;
+
+    std::string_view name;
+    T Class::*member;
+    size_t offset;
+    static constexpr size_t size = sizeof(T);
+
+    [[nodiscard]] constexpr auto get(Class &obj) const -> T & { return obj.*member; }
+    [[nodiscard]] constexpr auto get(const Class &obj) const -> const T & { return obj.*member; }
+};
+
+template<typename T>
+concept Reflected = requires { T::reflect_fields(); };
+
+// tuple of Field<T, ...>, in declaration order
+template<Reflected T>
+constexpr auto fields()
+{
+    return T::reflect_fields();
+}
+
+template<Reflected T>
+constexpr size_t field_count = std::tuple_size_v<decltype(T::reflect_fields())>;
+
+// calls fn(field) for every field of T, fn can use decltype(field)::type and field.get(obj)
+template<Reflected T, typename F>
+constexpr void for_each_field(F &&fn)
+{
+    std::apply([&fn](const auto &...field) { (fn(field), ...); }, fields<T>());
+}
+
+// sum of the field sizes, smaller than sizeof(T) when T has padding
+template<Reflected T>
+constexpr size_t fields_size = std::apply(
+    [](const auto &...field) { return (size_t {0} + ... + std::decay_t<decltype(field)>::size); }, fields<T>()
+);
+
+// true when the fields cover every byte of T: its object representation can be copied or hashed as is
+template<Reflected T>
+constexpr bool is_packed = fields_size<T> == sizeof(T);
+
+} // namespace reflect
+
+// REFLECT_FOR_EACH(macro, ClassName, a, b, c) -> macro(ClassName, a) macro(ClassName, b) macro(ClassName, c)
+#define REFLECT_PARENS ()
+#define REFLECT_EXPAND(...) REFLECT_EXPAND3(REFLECT_EXPAND3(REFLECT_EXPAND3(REFLECT_EXPAND3(__VA_ARGS__))))
+#define REFLECT_EXPAND3(...) REFLECT_EXPAND2(REFLECT_EXPAND2(REFLECT_EXPAND2(REFLECT_EXPAND2(__VA_ARGS__))))
+#define REFLECT_EXPAND2(...) REFLECT_EXPAND1(REFLECT_EXPAND1(REFLECT_EXPAND1(REFLECT_EXPAND1(__VA_ARGS__))))
+#define REFLECT_EXPAND1(...) __VA_ARGS__
+#define REFLECT_FOR_EACH(macro, ClassName, ...) \
+    __VA_OPT__(REFLECT_EXPAND(REFLECT_FOR_EACH_HELPER(macro, ClassName, __VA_ARGS__)))
+#define REFLECT_FOR_EACH_HELPER(macro, ClassName, field, ...) \
+    macro(ClassName, field) __VA_OPT__(REFLECT_FOR_EACH_AGAIN REFLECT_PARENS(macro, ClassName, __VA_ARGS__))
+#define REFLECT_FOR_EACH_AGAIN() REFLECT_FOR_EACH_HELPER
+
+#define REFLECT_FIELD(ClassName, field) \
+    reflect::Field<ClassName, decltype(ClassName::field)> {#field, &ClassName::field, offsetof(ClassName, field)},
+
+// Macro to declare the reflected fields of a struct
+#define REFLECT(ClassName, ...)                                                       \
+    static constexpr auto reflect_fields()                                            \
+    {                                                                                 \
+        return std::tuple {REFLECT_FOR_EACH(REFLECT_FIELD, ClassName, __VA_ARGS__)}; \
+    }
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+// Space filling curve keys, used with World::sort_by to lay entities out so that
+// entities close in space are also close in memory
+namespace spatial {
+
+// spreads the 32 bits of v over the even bits of the result
+constexpr auto part_by_one(uint32_t v) -> uint64_t
+{
+    uint64_t x = v;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x << 2)) & 0x3333333333333333ULL;
+    x = (x | (x << 1)) & 0x5555555555555555ULL;
+    return x;
+}
+
+constexpr auto morton2d(uint32_t x, uint32_t y) -> uint64_t
+{
+    return part_by_one(x) | (part_by_one(y) << 1);
+}
+
+// distance along a Hilbert curve covering a 2^order x 2^order grid
+// https://en.wikipedia.org/wiki/Hilbert_curve#Applications_and_mapping_algorithms
+constexpr auto hilbert2d(uint32_t x, uint32_t y, unsigned order = 16) -> uint64_t
+{
+    uint64_t d = 0;
+    for (uint64_t s = uint64_t {1} << (order - 1); s > 0; s /= 2) {
+        uint32_t rx = (x & s) > 0 ? 1 : 0;
+        uint32_t ry = (y & s) > 0 ? 1 : 0;
+        d += s * s * ((3 * rx) ^ ry);
+        // rotate the quadrant so the curve stays continuous
+        if (ry == 0) {
+            if (rx == 1) {
+                x = static_cast<uint32_t>(s - 1 - x);
+                y = static_cast<uint32_t>(s - 1 - y);
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+// maps a world coordinate to a grid cell, clamped to [0, max_cell]
+constexpr auto quantize(float value, float origin, float cell_size, uint32_t max_cell) -> uint32_t
+{
+    float cell = (value - origin) / cell_size;
+    if (cell <= 0.0f) {
+        return 0;
+    }
+    if (cell >= static_cast<float>(max_cell)) {
+        return max_cell;
+    }
+    return static_cast<uint32_t>(cell);
+}
+
+// key functions for any position type having x and y members
+struct MortonKey {
+    float cell_size = 1.0f;
+    float origin_x = 0.0f;
+    float origin_y = 0.0f;
+
+    template<typename P>
+    constexpr auto operator()(const P &pos) const -> uint64_t
+    {
+        constexpr uint32_t max_cell = UINT32_MAX;
+        return morton2d(
+            quantize(pos.x, origin_x, cell_size, max_cell), quantize(pos.y, origin_y, cell_size, max_cell)
+        );
+    }
+};
+
+// better locality than Morton (no long jumps between quadrants) at a slightly higher cost per key
+struct HilbertKey {
+    float cell_size = 1.0f;
+    float origin_x = 0.0f;
+    float origin_y = 0.0f;
+
+    static constexpr unsigned order = 16;
+
+    template<typename P>
+    constexpr auto operator()(const P &pos) const -> uint64_t
+    {
+        constexpr uint32_t max_cell = (1U << order) - 1;
+        return hilbert2d(
+            quantize(pos.x, origin_x, cell_size, max_cell), quantize(pos.y, origin_y, cell_size, max_cell),
+            order
+        );
+    }
+};
+
+} // namespace spatial
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+// Fixed timestep accumulator: the simulation always advances by `step` seconds, however long frames take
+// https://gafferongames.com/post/fix_your_timestep/
+class FixedTimestep {
+private:
+    float step;
+    float accumulator = 0;
+    // bounds the catch-up after a long stall so a slow tick can not snowball
+    size_t max_ticks_per_frame;
+
+public:
+    explicit FixedTimestep(float step, size_t max_ticks_per_frame = 8):
+        step(step),
+        max_ticks_per_frame(max_ticks_per_frame)
+    {
+    }
+
+    [[nodiscard]] inline auto dt() const -> float { return step; }
+
+    // calls tick(step) as many times as frame_dt allows, returns the number of ticks run
+    template<typename F>
+    inline auto advance(float frame_dt, F &&tick) -> size_t
+    {
+        accumulator = std::min(accumulator + frame_dt, step * static_cast<float>(max_ticks_per_frame));
+        size_t ticks = 0;
+        while (accumulator >= step) {
+            tick(step);
+            accumulator -= step;
+            ticks++;
+        }
+        return ticks;
+    }
+
+    // progress towards the next tick in [0, 1), for interpolating between the last two states
+    [[nodiscard]] inline auto alpha() const -> float { return accumulator / step; }
+};
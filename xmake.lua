@@ -4,6 +4,13 @@ add_rules("mode.debug", "mode.release")
 add_requires("raylib")
 set_languages("c++20")
 
+option("profile")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Record profiler zones (trace.json and per-system statistics)")
+    add_defines("BECS_PROFILE")
+option_end()
+
 add_rules("plugin.vsxmake.autoupdate")
 add_rules("plugin.compile_commands.autoupdate")
 
@@ -11,4 +18,23 @@ target("game")
     set_kind("binary")
     add_files("src/*.cpp")
     add_packages("raylib")
+    add_syslinks("pthread")
     add_defines("DEBUG")
+    add_options("profile")
+
+-- headless simulation for dedicated servers, no raylib: xmake run server [--entities N] [--ticks N]
+target("server")
+    set_kind("binary")
+    add_files("src/main.cpp")
+    add_syslinks("pthread")
+    add_defines("HEADLESS")
+    add_options("profile")
+
+-- scenario benchmarks, no raylib: xmake run bench [--filter name] [--json out.json] [--reps N]
+target("bench")
+    set_kind("binary")
+    add_files("bench/*.cpp")
+    add_includedirs("src")
+    add_syslinks("pthread")
+    add_options("profile")
+    set_default(false)